@@ -0,0 +1,127 @@
+#pragma once
+
+#include "othello.h"
+#include "othengine.h"
+#include "othobserver.h"
+#include <memory>
+#include <future>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+namespace oth {
+    /*
+        A search started by AsyncEngine. It searches its own copy of the position,
+        so the game it was taken from can go on. Any thread may wait for it,
+        or cancel it.
+    */
+    class SearchTask {
+        friend class AsyncEngine;
+
+        std::unique_ptr<Othello> position;
+        SearchRequest request;
+        std::atomic<bool> cancelFlag;
+        std::promise<SearchResult> promise;
+        std::shared_future<SearchResult> result;
+        NullObserver quiet;
+
+public:
+
+        SearchTask(const Othello& position, const SearchLimits& limits, std::function<void(const SearchProgress&)> progress) :
+                position(new Othello(position)), cancelFlag(false), result(promise.get_future().share()) {
+            // The copy would show the engine's messages on the observer of the game.
+            this->position->setObserver(quiet);
+            request.limits = limits;
+            request.cancel = &cancelFlag;
+            request.progress = progress;
+        }
+
+        // Asks the search to stop, and returns at once. The result is then the best
+        // move found so far, or the first legal move if the search had not started.
+        void cancel() {
+            cancelFlag = true;
+        }
+
+        bool done() const {
+            return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }
+
+        // Waits for the result.
+        const SearchResult& wait() const {
+            return result.get();
+        }
+
+        // Waits at most milliseconds, and returns whether the result is there.
+        bool waitFor(int milliseconds) const {
+            return result.wait_for(std::chrono::milliseconds(milliseconds)) == std::future_status::ready;
+        }
+
+        // The result, for code that works with futures.
+        std::shared_future<SearchResult> future() const {
+            return result;
+        }
+    };
+
+    /*
+        Runs the searches of a blocking Engine on a thread of their own, with
+        Engine::searchMove, so they can be waited for, limited and cancelled
+        from outside the engine.
+
+        An engine searches one position at a time, so starting a search cancels
+        the one before and waits for it. Run many searches at once with one
+        AsyncEngine, and one engine, for each.
+
+        Example:
+            oth::MinimaxEngine minimax;
+            oth::AsyncEngine async(minimax);
+            std::shared_ptr<oth::SearchTask> task = async.start(board, limits,
+                [](const oth::SearchProgress& p) { std::cout << p.depth << std::endl; });
+            if (!task->waitFor(100)) task->cancel();
+            oth::Point move = task->wait().move;
+    */
+    class AsyncEngine {
+        Engine& engine;
+        std::thread searcher;
+        std::shared_ptr<SearchTask> running;
+
+public:
+
+        // The engine must outlive this, and not be used by anything else meanwhile.
+        explicit AsyncEngine(Engine& engine) : engine(engine) {}
+
+        ~AsyncEngine() {
+            stop();
+        }
+
+        AsyncEngine(const AsyncEngine&) = delete;
+        AsyncEngine& operator=(const AsyncEngine&) = delete;
+
+        // Starts searching a copy of position, which must have a move for position.turn.
+        // progress is called on the searching thread after every iteration, for engines
+        // that iterate.
+        std::shared_ptr<SearchTask> start(const Othello& position, const SearchLimits& limits,
+                std::function<void(const SearchProgress&)> progress = nullptr) {
+            stop();
+
+            running = std::make_shared<SearchTask>(position, limits, progress);
+            std::shared_ptr<SearchTask> task = running;
+            Engine* searching = &engine;
+            searcher = std::thread([task, searching]() {
+                try {
+                    task->promise.set_value(searching->searchMove(*task->position, task->request));
+                } catch (...) {
+                    task->promise.set_exception(std::current_exception());
+                }
+            });
+            return task;
+        }
+
+        // Cancels the running search, and waits for it to end.
+        void stop() {
+            if (!searcher.joinable()) return;
+            running->cancel();
+            searcher.join();
+            running.reset();
+        }
+    };
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+
+namespace oth {
+    /*
+        Bitboard helpers for the 8x8 board. A square (x, y) is stored in bit y*8+x,
+        so one uint64_t holds every disc of one color.
+    */
+    namespace bb {
+        // Files that must be masked out after a shift, so pieces don't wrap rows.
+        const uint64_t notAFile = 0xfefefefefefefefeULL;
+        const uint64_t notHFile = 0x7f7f7f7f7f7f7f7fULL;
+
+        // Shift amounts, in the same order as oth::direction ({y, x}).
+        // Positive means left shift, negative means right shift.
+        const static int shifts[8] = { 9, 8, 7, -1, -9, -8, -7, 1 };
+
+        // Masks applied after the shift with the same index.
+        const static uint64_t masks[8] = {
+            notAFile, ~0ULL, notHFile, notHFile, notHFile, ~0ULL, notAFile, notAFile
+        };
+
+        inline int square(int x, int y) { return (y << 3) | x; }
+
+        inline uint64_t bit(int x, int y) { return 1ULL << square(x, y); }
+
+        inline int popCount(uint64_t b) { return __builtin_popcountll(b); }
+
+        // Removes the lowest set bit from b, and returns its index.
+        inline int popLsb(uint64_t& b) {
+            int sq = __builtin_ctzll(b);
+            b &= b - 1;
+            return sq;
+        }
+
+        // Moves every bit one step to the direction with index i.
+        inline uint64_t shift(uint64_t b, int i) {
+            return shifts[i] > 0 ?
+                (b << shifts[i]) & masks[i]:
+                (b >> -shifts[i]) & masks[i];
+        }
+
+        // Returns every empty square where own can flank at least one opp disc.
+        inline uint64_t moves(uint64_t own, uint64_t opp) {
+            uint64_t empty = ~(own | opp);
+            uint64_t result = 0;
+
+            for (int i = 0; i < 8; i++) {
+                // Grow a run of opponent discs from our discs, at most 6 long.
+                uint64_t run = shift(own, i) & opp;
+                run |= shift(run, i) & opp;
+                run |= shift(run, i) & opp;
+                run |= shift(run, i) & opp;
+                run |= shift(run, i) & opp;
+                run |= shift(run, i) & opp;
+
+                // The square right after the run is a move, if it is empty.
+                result |= shift(run, i) & empty;
+            }
+
+            return result;
+        }
+
+        // Squares whose neighbor to the direction with index i is off the board.
+        inline uint64_t edge(int i) {
+            return ~shift(~0ULL, (i + 4) % 8);
+        }
+
+        // Discs of own that can never be flipped again. Not every one is found: a disc
+        // is only known to be stable if every line through it is full, or has the edge
+        // or a stable disc of own right next to it on one side.
+        inline uint64_t stable(uint64_t own, uint64_t opp) {
+            uint64_t filled = own | opp;
+
+            // Squares on a full line, for each of the 4 lines through a square.
+            uint64_t full[4];
+            for (int i = 0; i < 4; i++) {
+                uint64_t toward = filled, back = filled;
+                for (int step = 0; step < 7; step++) {
+                    toward = filled & (shift(toward, i + 4) | edge(i));
+                    back = filled & (shift(back, i) | edge(i + 4));
+                }
+                full[i] = toward & back;
+            }
+
+            uint64_t result = 0;
+            for (;;) {
+                uint64_t found = own;
+                for (int i = 0; i < 4; i++) {
+                    found &= full[i] | edge(i) | edge(i + 4) | shift(result, i) | shift(result, i + 4);
+                }
+                if (found == result) return result;
+                result = found;
+            }
+        }
+
+        // Squares from every square to the edge, for every direction, without the square itself.
+        // Built on first use.
+        inline const uint64_t* rays(int sq) {
+            struct Table {
+                uint64_t rays[64][8];
+                Table() {
+                    for (int from = 0; from < 64; from++) {
+                        for (int i = 0; i < 8; i++) {
+                            rays[from][i] = 0;
+                            for (uint64_t cur = shift(1ULL << from, i); cur; cur = shift(cur, i)) rays[from][i] |= cur;
+                        }
+                    }
+                }
+            };
+            static const Table table;
+            return table.rays[sq];
+        }
+
+        // Discs flipped on the ray to the direction with index i: the squares before
+        // the first own disc, if they are all opp discs.
+        template <int i>
+        inline uint64_t flipsTo(uint64_t own, uint64_t opp, uint64_t ray) {
+            uint64_t anchors = own & ray;
+            if (!anchors) return 0;
+
+            // Rays with a positive shift go to higher bits, so the first disc is the lowest one.
+            uint64_t between = shifts[i] > 0 ?
+                ray & ((anchors & (0 - anchors)) - 1) :
+                ray & ~((2ULL << (63 - __builtin_clzll(anchors))) - 1);
+            return (between & ~opp) == 0 ? between : 0;
+        }
+
+        // Returns the discs that get flipped when own plays on square sq.
+        inline uint64_t flips(uint64_t own, uint64_t opp, int sq) {
+            const uint64_t* ray = rays(sq);
+            return flipsTo<0>(own, opp, ray[0]) | flipsTo<1>(own, opp, ray[1]) |
+                flipsTo<2>(own, opp, ray[2]) | flipsTo<3>(own, opp, ray[3]) |
+                flipsTo<4>(own, opp, ray[4]) | flipsTo<5>(own, opp, ray[5]) |
+                flipsTo<6>(own, opp, ray[6]) | flipsTo<7>(own, opp, ray[7]);
+        }
+    }
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include "othello.h"
+#include "zobrist.h"
+#include "mappedfile.h"
+
+namespace oth {
+    /*
+        Opening book: the best move of positions searched ahead of time, in a sorted
+        file that is mapped into memory. Opening it reads nothing, and every engine
+        and process using the same file shares one copy of it.
+
+        A position and its 7 rotations and mirrors are one entry. The key is the
+        smallest zobrist hash of the 8 boards (with the turn), and the move is stored
+        on that board, so it is turned back when probing.
+
+        File format, little endian:
+            "OTHB", version (1 byte), board size (1 byte), 2 unused bytes, entry count (8 bytes)
+            then the entries sorted by key, ENTRYSIZE bytes each:
+            key (8 bytes), move y * size + x (2 bytes), score in 1/16 discs (2 bytes)
+    */
+    class OpeningBook {
+
+        const static int VERSION = 1;
+        const static int HEADERSIZE = 16;
+
+        std::unique_ptr<MappedFile> file;
+        const unsigned char* entries;
+        uint64_t count;
+        int boardSize;
+
+        static uint64_t read(const unsigned char* bytes, int length) {
+            uint64_t value = 0;
+            for (int i = length - 1; i >= 0; i--) value = (value << 8) | bytes[i];
+            return value;
+        }
+
+        static void write(std::vector<unsigned char>& bytes, uint64_t value, int length) {
+            for (int i = 0; i < length; i++) bytes.push_back((value >> (i * 8)) & 0xff);
+        }
+
+        OpeningBook() {}
+
+public:
+
+        const static int ENTRYSIZE = 12;
+
+        // Units of a disc in the scores.
+        const static int SCALE = 16;
+
+        struct Entry {
+            uint64_t key;
+            // Move on the board of the key.
+            Point move;
+            // Score of the move for the side to move, in 1/SCALE discs.
+            int score;
+        };
+
+        // Maps a book file. Throws std::runtime_error if it can't be read or is not a book.
+        static std::shared_ptr<const OpeningBook> open(const std::string& path) {
+            std::shared_ptr<OpeningBook> book(new OpeningBook());
+            book->file.reset(new MappedFile(path));
+
+            const unsigned char* bytes = book->file->data();
+            size_t size = book->file->size();
+            if (size < HEADERSIZE || std::string((const char*)bytes, 4) != "OTHB") {
+                throw std::runtime_error(path + " is not a book file");
+            }
+            if (bytes[4] != VERSION) throw std::runtime_error(path + " is a book of another version");
+            if (bytes[5] < 4 || bytes[5] > Othello::MAXSIZE) throw std::runtime_error(path + " has a bad board size");
+
+            book->boardSize = bytes[5];
+            book->count = read(bytes + 8, 8);
+            if (book->count > (size - HEADERSIZE) / ENTRYSIZE) throw std::runtime_error(path + " is too short");
+            book->entries = bytes + HEADERSIZE;
+
+            return book;
+        }
+
+        // Writes entries of a board size to a book file, sorted. Entries with the same
+        // key are kept once. Throws std::runtime_error if it can't be written.
+        static void save(const std::string& path, int size, std::vector<Entry> entries) {
+            std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+            entries.erase(std::unique(entries.begin(), entries.end(),
+                [](const Entry& a, const Entry& b) { return a.key == b.key; }), entries.end());
+
+            std::vector<unsigned char> bytes = { 'O', 'T', 'H', 'B', VERSION, (unsigned char)size, 0, 0 };
+            write(bytes, entries.size(), 8);
+            for (size_t i = 0; i < entries.size(); i++) {
+                write(bytes, entries[i].key, 8);
+                write(bytes, entries[i].move.y * size + entries[i].move.x, 2);
+                write(bytes, (uint16_t)(int16_t)entries[i].score, 2);
+            }
+
+            std::ofstream out(path, std::ios::binary);
+            if (!out.write((const char*)bytes.data(), bytes.size())) throw std::runtime_error("Can't write " + path);
+        }
+
+        // Moves p by one of the 8 symmetries of a board of size: bit 2 swaps x and y,
+        // then bit 0 mirrors x and bit 1 mirrors y.
+        static Point transform(Point p, int symmetry, int size) {
+            if (symmetry & 4) std::swap(p.x, p.y);
+            if (symmetry & 1) p.x = size - 1 - p.x;
+            if (symmetry & 2) p.y = size - 1 - p.y;
+            return p;
+        }
+
+        // Undoes transform.
+        static Point untransform(Point p, int symmetry, int size) {
+            if (symmetry & 1) p.x = size - 1 - p.x;
+            if (symmetry & 2) p.y = size - 1 - p.y;
+            if (symmetry & 4) std::swap(p.x, p.y);
+            return p;
+        }
+
+        // Key of the board and its turn, the same for all of its symmetries.
+        // symmetry gets the one that turns the board into the board of the key.
+        static uint64_t key(Othello& board, int& symmetry) {
+            uint64_t keys[8] = {};
+            for (int y = 0; y < board.size; y++) {
+                for (int x = 0; x < board.size; x++) {
+                    Color color = board.at(x, y);
+                    if (color == none) continue;
+                    for (int s = 0; s < 8; s++) {
+                        Point p = transform(Point(x, y), s, board.size);
+                        keys[s] ^= zobrist::piece(color, p.x, p.y);
+                    }
+                }
+            }
+
+            symmetry = 0;
+            for (int s = 1; s < 8; s++) {
+                if (keys[s] < keys[symmetry]) symmetry = s;
+            }
+            return board.turn == white ? keys[symmetry] ^ zobrist::whiteTurn() : keys[symmetry];
+        }
+
+        // Board size of the book.
+        int size() const {
+            return boardSize;
+        }
+
+        // Number of positions in the book.
+        uint64_t positions() const {
+            return count;
+        }
+
+        // Looks for the board. Returns whether it was found with a legal move,
+        // and puts the move and its score in 1/SCALE discs in move and score.
+        bool probe(Othello& board, Point& move, int& score) const {
+            if (board.size != boardSize) return false;
+
+            int symmetry;
+            uint64_t wanted = key(board, symmetry);
+
+            // Binary search over the sorted keys.
+            uint64_t low = 0, high = count;
+            while (low < high) {
+                uint64_t mid = low + (high - low) / 2;
+                if (read(entries + mid * ENTRYSIZE, 8) < wanted) low = mid + 1;
+                else high = mid;
+            }
+            if (low == count) return false;
+
+            const unsigned char* entry = entries + low * ENTRYSIZE;
+            if (read(entry, 8) != wanted) return false;
+
+            int square = read(entry + 8, 2);
+            move = untransform(Point(square % boardSize, square / boardSize), symmetry, boardSize);
+            score = (int16_t)read(entry + 10, 2);
+
+            // Another position with the same key would give a move that may not be legal.
+            return board.getMoves(board.turn).contains(move);
+        }
+    };
+}
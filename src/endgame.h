@@ -0,0 +1,444 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <functional>
+#include "bitboard.h"
+
+namespace oth {
+    // Squares of the solver from the best to the worst: corners, edges, then the
+    // inner squares, and the ones next to the corners last.
+    const static int solveOrder[64] = {
+        0, 7, 56, 63,
+        2, 5, 16, 23, 40, 47, 58, 61,
+        18, 21, 42, 45,
+        3, 4, 24, 31, 32, 39, 59, 60,
+        19, 20, 26, 29, 34, 37, 43, 44,
+        11, 12, 25, 30, 33, 38, 51, 52,
+        10, 13, 17, 22, 41, 46, 50, 53,
+        1, 6, 8, 15, 48, 55, 57, 62,
+        9, 14, 49, 54,
+        27, 28, 35, 36
+    };
+
+    /*
+        Exact solver for the end of an 8x8 game. Works on the two bitboards only,
+        so nothing else of the board is touched while solving.
+
+        Scores are the final disc difference of the side to move, without giving
+        the empty squares to anyone, the same as Othello::getScore.
+
+        - The empty squares are kept in a list, in a fixed order of how good the
+          squares usually are, so moves near the end don't rescan the board.
+        - With many empties, moves that leave the opponent the fewest replies are
+          tried first (fastest first). Below that, moves in regions with an odd
+          number of empties are tried first (parity).
+        - The last 3, 2 and 1 empties have their own routines.
+        - Positions with many empties are kept in a small table of bounds, and a
+          move whose position is known to be good enough cuts without a search.
+        - Stable discs of the opponent bound the score, which can cut too.
+    */
+    class EndgameSolver {
+
+public:
+
+        // Called every POLLINTERVAL nodes. Returning true stops the search,
+        // and every score after that is meaningless.
+        std::function<bool()> poll;
+
+        // Nodes searched since the solver was made.
+        long long nodes = 0;
+
+        // Whether the last solve was stopped by poll.
+        bool stopped = false;
+
+        const static int POLLINTERVAL = 1024;
+
+        EndgameSolver() : table(TABLESIZE) {
+            for (int sq = 0; sq < 64; sq++) {
+                around[sq] = 0;
+                for (int i = 0; i < 8; i++) around[sq] |= bb::shift(1ULL << sq, i);
+            }
+        }
+
+        // Starts a new search. Entries of older ones are replaced first.
+        void newSearch() {
+            age++;
+        }
+
+        // Forgets every stored position.
+        void clear() {
+            if (solved) table.assign(TABLESIZE, Entry());
+            solved = false;
+            age = 0;
+        }
+
+        // Solves the position with own to move, and returns the exact score if it is
+        // inside (alpha, beta). Otherwise the score is a bound on the side of the window
+        // it falls on. best gets the best square (y * 8 + x), or -1 if own has to pass.
+        int solve(uint64_t own, uint64_t opp, int alpha, int beta, int& best) {
+            stopped = false;
+            solved = true;
+            rootBest = -1;
+
+            // Link the empty squares, in their fixed order.
+            uint64_t empty = ~(own | opp);
+            Empty* last = &head;
+            int count = 0;
+            parity = 0;
+            for (int i = 0; i < 64; i++) {
+                int sq = solveOrder[i];
+                if (!(empty & (1ULL << sq))) continue;
+
+                squares[sq].square = sq;
+                squares[sq].quadrant = quadrantOf(sq);
+                squares[sq].prev = last;
+                last->next = &squares[sq];
+                last = &squares[sq];
+
+                parity ^= squares[sq].quadrant;
+                count++;
+            }
+            last->next = nullptr;
+
+            int score = search(own, opp, alpha, beta, count, false, true);
+            best = rootBest;
+            return score;
+        }
+
+private:
+
+        // Up to this many empties, searchParity is used instead of fastest first,
+        // which costs more than it saves so close to the end.
+        const static int FASTESTFIRST = 5;
+
+        // Positions with at least this many empties go to the table.
+        const static int TABLEEMPTIES = 7;
+
+        const static int TABLESIZE = 1 << 16;
+
+        struct Empty {
+            int square;
+            // Bit of the quadrant, for the parity.
+            unsigned quadrant;
+            Empty* prev;
+            Empty* next;
+        };
+
+        struct Entry {
+            uint64_t own = 0;
+            uint64_t opp = 0;
+            signed char lower = -64;
+            signed char upper = 64;
+            signed char best = -1;
+            signed char empties = 0;
+            // Search the entry was stored by.
+            unsigned char age = 0;
+        };
+
+        // Empty list, head.next is the first empty square.
+        Empty head;
+        Empty squares[64];
+
+        // Bit q is set when quadrant q has an odd number of empties.
+        unsigned parity = 0;
+
+        std::vector<Entry> table;
+
+        // Squares next to every square. A move needs an opponent disc there.
+        uint64_t around[64];
+
+        int rootBest = -1;
+
+        // Counts the searches, so the table can tell old entries.
+        unsigned char age = 0;
+
+        // Whether anything was solved since the table was cleared.
+        bool solved = false;
+
+        static unsigned quadrantOf(int sq) {
+            return 1u << (((sq >> 2) & 1) | ((sq >> 4) & 2));
+        }
+
+        static int finalScore(uint64_t own, uint64_t opp) {
+            return bb::popCount(own) - bb::popCount(opp);
+        }
+
+        bool count() {
+            if ((++nodes & (POLLINTERVAL - 1)) == 0 && poll && poll()) stopped = true;
+            return stopped;
+        }
+
+        void remove(Empty* e) {
+            e->prev->next = e->next;
+            if (e->next) e->next->prev = e->prev;
+            parity ^= e->quadrant;
+        }
+
+        void restore(Empty* e) {
+            e->prev->next = e;
+            if (e->next) e->next->prev = e;
+            parity ^= e->quadrant;
+        }
+
+        // Two entries for every key: the first keeps the most empties of the current
+        // search, the second the last stored position.
+        Entry* bucket(uint64_t own, uint64_t opp) {
+            uint64_t key = (own * 0x9e3779b97f4a7c15ULL) ^ (opp * 0xc2b2ae3d27d4eb4fULL);
+            return &table[((key ^ (key >> 29)) & (TABLESIZE / 2 - 1)) * 2];
+        }
+
+        // Entry of the position, or null.
+        Entry* find(uint64_t own, uint64_t opp) {
+            Entry* b = bucket(own, opp);
+            if (b[0].own == own && b[0].opp == opp) return &b[0];
+            if (b[1].own == own && b[1].opp == opp) return &b[1];
+            return nullptr;
+        }
+
+        void store(uint64_t own, uint64_t opp, int empties, int lower, int upper, int best) {
+            Entry* e = find(own, opp);
+            if (!e) {
+                Entry* b = bucket(own, opp);
+                if (b[0].age != age || empties >= b[0].empties) {
+                    b[1] = b[0];
+                    e = &b[0];
+                } else {
+                    e = &b[1];
+                }
+                e->own = own;
+                e->opp = opp;
+                e->lower = -64;
+                e->upper = 64;
+            }
+
+            // Bounds only get tighter.
+            if (lower > e->lower) e->lower = lower;
+            if (upper < e->upper) e->upper = upper;
+            e->best = best;
+            e->empties = empties;
+            e->age = age;
+        }
+
+        // Last empty square. Nobody has to search anymore, so only the flips are counted.
+        int solve1(uint64_t own, uint64_t opp, int sq) {
+            count();
+            int score = finalScore(own, opp);
+
+            int flipped = opp & around[sq] ? bb::popCount(bb::flips(own, opp, sq)) : 0;
+            if (flipped) return score + flipped * 2 + 1;
+
+            // Own passes, and the opponent may take the square.
+            flipped = own & around[sq] ? bb::popCount(bb::flips(opp, own, sq)) : 0;
+            if (flipped) return score - flipped * 2 - 1;
+
+            return score;
+        }
+
+        int solve2(uint64_t own, uint64_t opp, int alpha, int beta, int sq1, int sq2, bool passed) {
+            if (count()) return 0;
+
+            int best = -64;
+            bool moved = false;
+
+            uint64_t flipped = opp & around[sq1] ? bb::flips(own, opp, sq1) : 0;
+            if (flipped) {
+                moved = true;
+                best = -solve1(opp & ~flipped, own | flipped | (1ULL << sq1), sq2);
+                if (best >= beta) return best;
+            }
+
+            flipped = opp & around[sq2] ? bb::flips(own, opp, sq2) : 0;
+            if (flipped) {
+                moved = true;
+                int score = -solve1(opp & ~flipped, own | flipped | (1ULL << sq2), sq1);
+                if (score > best) best = score;
+            }
+
+            if (moved) return best;
+            if (passed) return finalScore(own, opp);
+            return -solve2(opp, own, -beta, -alpha, sq1, sq2, true);
+        }
+
+        int solve3(uint64_t own, uint64_t opp, int alpha, int beta, bool passed) {
+            if (count()) return 0;
+
+            int sq[3];
+            int n = 0;
+            for (Empty* e = head.next; e; e = e->next) sq[n++] = e->square;
+
+            // The square alone in its quadrant goes first.
+            if (quadrantOf(sq[0]) == quadrantOf(sq[1])) std::swap(sq[0], sq[2]);
+            else if (quadrantOf(sq[0]) == quadrantOf(sq[2])) std::swap(sq[0], sq[1]);
+
+            int best = -64;
+            bool moved = false;
+            for (int i = 0; i < 3; i++) {
+                uint64_t flipped = opp & around[sq[i]] ? bb::flips(own, opp, sq[i]) : 0;
+                if (!flipped) continue;
+                moved = true;
+
+                int a = sq[i == 0 ? 1 : 0];
+                int b = sq[i == 2 ? 1 : 2];
+                int score = -solve2(opp & ~flipped, own | flipped | (1ULL << sq[i]), -beta, -(alpha > best ? alpha : best), a, b, false);
+
+                if (score > best) {
+                    best = score;
+                    if (best >= beta) return best;
+                }
+            }
+
+            if (moved) return best;
+            if (passed) return finalScore(own, opp);
+            return -solve3(opp, own, -beta, -alpha, true);
+        }
+
+        // Plain alpha-beta for the few empties above solve3, in parity order.
+        // Moves are found by trying the empty squares, without a move mask.
+        int searchParity(uint64_t own, uint64_t opp, int alpha, int beta, int empties, bool passed) {
+            if (count()) return 0;
+
+            int best = -64 - 1;
+            bool moved = false;
+            for (int odd = 1; odd >= 0 && best < beta; odd--) {
+                for (Empty* e = head.next; e; e = e->next) {
+                    if (((parity & e->quadrant) != 0) != (odd == 1)) continue;
+                    if (!(opp & around[e->square])) continue;
+
+                    uint64_t flipped = bb::flips(own, opp, e->square);
+                    if (!flipped) continue;
+                    moved = true;
+
+                    uint64_t nextOpp = opp & ~flipped;
+                    uint64_t nextOwn = own | flipped | (1ULL << e->square);
+                    int window = alpha > best ? alpha : best;
+
+                    remove(e);
+                    int score = empties == 4 ?
+                        -solve3(nextOpp, nextOwn, -beta, -window, false) :
+                        -searchParity(nextOpp, nextOwn, -beta, -window, empties - 1, false);
+                    restore(e);
+
+                    if (score > best) {
+                        best = score;
+                        if (best >= beta) break;
+                    }
+                }
+            }
+
+            if (moved) return best;
+            if (passed) return finalScore(own, opp);
+            return -searchParity(opp, own, -beta, -alpha, empties, true);
+        }
+
+        // Alpha-beta with a null window for every move after the first, in fastest first order.
+        int search(uint64_t own, uint64_t opp, int alpha, int beta, int empties, bool passed, bool root) {
+            if (count()) return 0;
+
+            if (empties <= FASTESTFIRST && !root) {
+                if (empties > 3) return searchParity(own, opp, alpha, beta, empties, passed);
+                if (empties == 3) return solve3(own, opp, alpha, beta, passed);
+                if (empties == 2) return solve2(own, opp, alpha, beta, head.next->square, head.next->next->square, passed);
+                if (empties == 1) return solve1(own, opp, head.next->square);
+                return finalScore(own, opp);
+            }
+
+            uint64_t moves = bb::moves(own, opp);
+            if (!moves) {
+                if (passed) return finalScore(own, opp);
+                return -search(opp, own, -beta, -alpha, empties, true, false);
+            }
+
+            // The opponent keeps its stable discs, which can be enough to fail low.
+            // Only counted when the opponent has enough discs for it.
+            if (bb::popCount(opp) * 2 >= 64 - alpha && !root) {
+                int most = 64 - 2 * bb::popCount(bb::stable(opp, own));
+                if (most <= alpha) return most;
+            }
+
+            // Bounds of earlier searches.
+            int hashMove = -1;
+            if (empties >= TABLEEMPTIES) {
+                const Entry* stored = find(own, opp);
+                if (stored) {
+                    if (!root) {
+                        if (stored->lower >= beta) return stored->lower;
+                        if (stored->upper <= alpha) return stored->upper;
+                        if (stored->lower == stored->upper) return stored->lower;
+                    }
+                    hashMove = stored->best;
+                }
+            }
+
+            // Moves in the order they are searched, with their flips. There are at
+            // most as many as empties, whatever the threshold of the solver.
+            Empty* list[64];
+            uint64_t flips[64];
+            int priority[64];
+            int n = 0;
+
+            for (Empty* e = head.next; e; e = e->next) {
+                if (!(moves & (1ULL << e->square))) continue;
+
+                uint64_t flipped = bb::flips(own, opp, e->square);
+                uint64_t after = own | flipped | (1ULL << e->square);
+
+                // A move already known to fail high ends the node without searching.
+                if (empties > TABLEEMPTIES && !root) {
+                    const Entry* child = find(opp & ~flipped, after);
+                    if (child && -child->upper >= beta) return -child->upper;
+                }
+
+                // Fewer replies is better, the fixed order breaks ties.
+                int p = -bb::popCount(bb::moves(opp & ~flipped, after)) * 16 - n;
+                if (e->square == hashMove) p += 1 << 20;
+
+                int j = n++;
+                for (; j > 0 && priority[j - 1] < p; j--) {
+                    list[j] = list[j - 1];
+                    flips[j] = flips[j - 1];
+                    priority[j] = priority[j - 1];
+                }
+                list[j] = e;
+                flips[j] = flipped;
+                priority[j] = p;
+            }
+
+            int alphaOrig = alpha;
+            int best = -64 - 1;
+            int bestSquare = -1;
+            for (int i = 0; i < n; i++) {
+                Empty* e = list[i];
+                uint64_t flipped = flips[i];
+                uint64_t nextOpp = opp & ~flipped;
+                uint64_t nextOwn = own | flipped | (1ULL << e->square);
+
+                remove(e);
+                int score;
+                if (i == 0) {
+                    score = -search(nextOpp, nextOwn, -beta, -alpha, empties - 1, false, false);
+                } else {
+                    score = -search(nextOpp, nextOwn, -alpha - 1, -alpha, empties - 1, false, false);
+                    if (score > alpha && score < beta) score = -search(nextOpp, nextOwn, -beta, -score, empties - 1, false, false);
+                }
+                restore(e);
+
+                if (stopped) return 0;
+
+                if (score > best) {
+                    best = score;
+                    bestSquare = e->square;
+                    if (root) rootBest = bestSquare;
+                    if (score > alpha) alpha = score;
+                    if (alpha >= beta) break;
+                }
+            }
+
+            if (empties >= TABLEEMPTIES) {
+                store(own, opp, empties, best > alphaOrig ? best : -64, best < beta ? best : 64, bestSquare);
+            }
+
+            return best;
+        }
+    };
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include "othello.h"
+#include "patterns.h"
+
+namespace oth {
+    /*
+        Evaluation from weight tables of the board's patterns, plus mobility.
+        The board keeps the pattern numbers up to date, so a leaf only costs
+        one table lookup per pattern instance.
+
+        Weights are in 1/SCALE of a disc, from black's side, and there is a set
+        for every phase of the game. They are fitted by tools/trainpatterns.cpp.
+
+        File format, little endian:
+            "OTHW", version (1 byte), board size (1 byte), phases (1 byte), shapes (1 byte)
+            then for every phase: mobility weight, then the table of every shape,
+            all as 16 bit integers.
+    */
+    class PatternEvaluator {
+
+        int boardSize;
+
+        // Weights of phase p start at p * perPhase: mobility, then every shape table.
+        std::vector<short> weights;
+        int offsets[patterns::SHAPES];
+        int perPhase;
+
+        const static int VERSION = 1;
+
+public:
+
+        // Phases of the game, by number of discs.
+        const static int PHASES = 4;
+
+        // Units of a disc.
+        const static int SCALE = 16;
+
+        // Every weight is 0.
+        PatternEvaluator(int size) : boardSize(size) {
+            perPhase = 1;
+            for (int shape = 0; shape < patterns::SHAPES; shape++) {
+                offsets[shape] = perPhase;
+                perPhase += patterns::values(shape, size);
+            }
+            weights.assign(PHASES * perPhase, 0);
+        }
+
+        // Loads the weights from a file.
+        // Throws std::runtime_error if it can't be read or is not a weight file.
+        static PatternEvaluator load(const std::string& path) {
+            std::ifstream file(path, std::ios::binary);
+            if (!file) throw std::runtime_error("Can't open " + path);
+
+            unsigned char header[8];
+            if (!file.read((char*)header, sizeof(header)) || std::string((char*)header, 4) != "OTHW") {
+                throw std::runtime_error(path + " is not a weight file");
+            }
+            if (header[4] != VERSION || header[6] != PHASES || header[7] != patterns::SHAPES) {
+                throw std::runtime_error(path + " has weights of another version");
+            }
+
+            if (header[5] < 4 || header[5] > Othello::MAXSIZE) throw std::runtime_error(path + " has a bad board size");
+
+            PatternEvaluator evaluator(header[5]);
+
+            std::vector<unsigned char> bytes(evaluator.weights.size() * 2);
+            if (!file.read((char*)bytes.data(), bytes.size())) throw std::runtime_error(path + " is too short");
+            for (size_t i = 0; i < evaluator.weights.size(); i++) {
+                evaluator.weights[i] = (short)(bytes[i * 2] | (bytes[i * 2 + 1] << 8));
+            }
+
+            return evaluator;
+        }
+
+        // Writes the weights to a file. Throws std::runtime_error if it can't be written.
+        void save(const std::string& path) const {
+            std::vector<unsigned char> bytes = { 'O', 'T', 'H', 'W', VERSION, (unsigned char)boardSize, PHASES, patterns::SHAPES };
+            for (size_t i = 0; i < weights.size(); i++) {
+                bytes.push_back(weights[i] & 0xff);
+                bytes.push_back((weights[i] >> 8) & 0xff);
+            }
+
+            std::ofstream file(path, std::ios::binary);
+            if (!file.write((const char*)bytes.data(), bytes.size())) throw std::runtime_error("Can't write " + path);
+        }
+
+        // Board size the weights are for.
+        int size() const {
+            return boardSize;
+        }
+
+        // Phase of a board with discs pieces on it.
+        int phase(int discs) const {
+            int p = (discs - 4) * PHASES / (boardSize * boardSize - 3);
+            return p < 0 ? 0 : p >= PHASES ? PHASES - 1 : p;
+        }
+
+        short& mobility(int phase) {
+            return weights[phase * perPhase];
+        }
+
+        short& weight(int phase, int shape, int value) {
+            return weights[phase * perPhase + offsets[shape] + value];
+        }
+
+        // Score of the board seen from the color whose turn it is, in 1/SCALE discs.
+        // Always inside the range of the final disc difference.
+        int evaluate(Othello& board) const {
+            int discs = board.getScore(black) + board.getScore(white);
+            const short* table = &weights[phase(discs) * perPhase];
+
+            int score = table[0] * (board.getMoves(black).size() - board.getMoves(white).size());
+            for (int i = 0; i < patterns::INSTANCES; i++) {
+                score += table[offsets[patterns::shapeOf[i]] + board.getPattern(i)];
+            }
+
+            if (board.turn == white) score = -score;
+
+            int limit = boardSize * boardSize * SCALE;
+            return score > limit ? limit : score < -limit ? -limit : score;
+        }
+    };
+}
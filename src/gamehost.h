@@ -0,0 +1,297 @@
+#pragma once
+
+#include "othello.h"
+#include "othengine.h"
+#include "transposition.h"
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+
+namespace oth {
+    /*
+        Hosts many games at once in one process, on a fixed pool of worker threads.
+
+        Every worker has its own engine, made by the factory, and plays one move
+        of one game at a time. Games waiting for a move are in one queue: a worker
+        takes the game at the front, plays its move, and puts it at the back. So
+        with N games and W workers, every game gets a move in turn, about every
+        N / W moves, and none can starve the others.
+
+        Every side has a clock, like in a tournament. The wait in the queue is
+        taken from it too, so a busy host leaves less time to think. A move gets
+        its share of the time left for the moves the side still has to play, and
+        a side whose clock runs out loses on time.
+
+        To share a transposition table and a book between the games, the factory
+        gives every engine the same ones (see MinimaxEngine::setTable). A shared
+        table is given to the host too, which moves its age on once every round,
+        when every game has had about one move, so the engines must not.
+
+        An engine that returns an illegal move forfeits its game, which ends
+        there, and the other games go on.
+    */
+    class GameHost {
+public:
+
+        typedef std::function<std::unique_ptr<Engine>()> EngineFactory;
+
+        // How a game is played.
+        struct GameSettings {
+            int size = 8;
+            // Moves played from the usual start, before the engines play.
+            std::vector<Point> opening;
+            // Time of each side for the whole game, in milliseconds.
+            int budget = 60000;
+            // Limits of every move on top of the clock, like a depth.
+            SearchLimits limits;
+        };
+
+        // How a game ended.
+        struct Result {
+            long long id = 0;
+            int blackDiscs = 0;
+            int whiteDiscs = 0;
+            int moves = 0;
+            // none if the game was played to the end.
+            Color lostOnTime = none;
+            // The side that returned an illegal move, and lost, or none.
+            Color forfeited = none;
+            // Time taken from the clock of each side, by color.
+            double milliseconds[3] = {};
+        };
+
+        // What the host did since the last takeStats.
+        struct Stats {
+            long long moves = 0;
+            long long games = 0;
+            long long timeLosses = 0;
+            long long forfeits = 0;
+            // Milliseconds from when a game waited for a move to when it was played,
+            // one for every move.
+            std::vector<double> latencies;
+        };
+
+private:
+
+        struct Game {
+            long long id;
+            std::unique_ptr<Othello> board;
+            GameSettings settings;
+            std::function<void(const Result&)> onEnd;
+            // Time left on the clock of each side, by color.
+            double remaining[3];
+            Result result;
+            // When it was put in the queue.
+            std::chrono::steady_clock::time_point waiting;
+        };
+
+        // Only to make boards. The workers' engines play the moves.
+        class NoEngine : public Engine {
+            Point nextMove(Othello& board) {
+                throw std::logic_error("Hosted games are played by the workers");
+            }
+        };
+        NoEngine placeholder;
+
+        std::mutex lock;
+        std::condition_variable gameReady;
+        std::deque<std::unique_ptr<Game>> queue;
+        long long nextId = 1;
+        // Games in the queue or being played.
+        std::atomic<long long> active;
+        Stats stats;
+
+        // The table shared by the engines, or null. Its age moves on every round.
+        std::shared_ptr<TranspositionTable> table;
+        // Moves played in this round.
+        long long roundMoves = 0;
+
+        // Set when the host stops. It cancels the running searches too.
+        std::atomic<bool> stopping;
+        std::vector<std::thread> workers;
+
+        // Puts a game at the back of the queue, waiting for its next move.
+        void enqueue(std::unique_ptr<Game> game) {
+            std::lock_guard<std::mutex> guard(lock);
+            game->waiting = std::chrono::steady_clock::now();
+            queue.push_back(std::move(game));
+            gameReady.notify_one();
+        }
+
+        // Plays the next move of game. Returns false if the game is over.
+        bool playMove(Game& game, Engine& engine, Stats& counted) {
+            Othello& board = *game.board;
+
+            // A side without moves passes, and two passes end the game.
+            if (board.getMoves(board.turn).empty()) {
+                board.switchTurn();
+                if (board.getMoves(board.turn).empty()) return false;
+            }
+
+            Color color = board.turn;
+            auto started = std::chrono::steady_clock::now();
+            double waited = std::chrono::duration<double, std::milli>(started - game.waiting).count();
+
+            // The share of the time left, for the moves the side still has to play.
+            int empties = board.size * board.size - board.getScore(white) - board.getScore(black);
+            int movesLeft = (empties + 1) / 2;
+            double share = game.remaining[color] / (movesLeft > 0 ? movesLeft : 1) - waited;
+
+            SearchRequest request;
+            request.limits = game.settings.limits;
+            request.cancel = &stopping;
+            int moveTime = share < 1 ? 1 : (int)share;
+            if (request.limits.moveTime <= 0 || moveTime < request.limits.moveTime) request.limits.moveTime = moveTime;
+
+            SearchResult searched = engine.searchMove(board, request);
+            if (stopping) return false;
+
+            double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - game.waiting).count();
+            game.remaining[color] -= latency;
+            game.result.milliseconds[color] += latency;
+            counted.latencies.push_back(latency);
+            counted.moves++;
+
+            // Like Othello::startGame, a move is checked before it is played.
+            if (!board.getMoves(color).contains(searched.move)) {
+                game.result.forfeited = color;
+                return false;
+            }
+
+            if (game.remaining[color] <= 0) {
+                game.result.lostOnTime = color;
+                return false;
+            }
+
+            board.playPiece(color, searched.move.x, searched.move.y, false);
+            board.switchTurn();
+            game.result.moves++;
+            return true;
+        }
+
+        void work(EngineFactory factory) {
+            std::unique_ptr<Engine> engine = factory();
+            // Counted here, and added to the shared ones with the next queue access.
+            Stats counted;
+
+            while (true) {
+                std::unique_ptr<Game> game;
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    stats.moves += counted.moves;
+                    stats.latencies.insert(stats.latencies.end(), counted.latencies.begin(), counted.latencies.end());
+                    roundMoves += counted.moves;
+                    if (table && roundMoves >= active) {
+                        table->newSearch();
+                        roundMoves = 0;
+                    }
+                    counted = Stats();
+
+                    gameReady.wait(guard, [&]() { return !queue.empty() || stopping; });
+                    if (stopping) return;
+                    game = std::move(queue.front());
+                    queue.pop_front();
+                }
+
+                if (playMove(*game, *engine, counted)) {
+                    enqueue(std::move(game));
+                    continue;
+                }
+                if (stopping) return;
+
+                game->result.blackDiscs = game->board->getScore(black);
+                game->result.whiteDiscs = game->board->getScore(white);
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    stats.games++;
+                    if (game->result.lostOnTime != none) stats.timeLosses++;
+                    if (game->result.forfeited != none) stats.forfeits++;
+                }
+                active--;
+                // Outside the lock, so it may add a game.
+                if (game->onEnd) game->onEnd(game->result);
+            }
+        }
+
+public:
+
+        // Starts workers threads. Each calls factory on its own thread for its engine.
+        // table is the one the factory gives every engine, if it does, to age it.
+        GameHost(int workers, EngineFactory factory, std::shared_ptr<TranspositionTable> table = nullptr) :
+                active(0), table(table), stopping(false) {
+            for (int i = 0; i < (workers < 1 ? 1 : workers); i++) this->workers.emplace_back(&GameHost::work, this, factory);
+        }
+
+        ~GameHost() {
+            stop();
+        }
+
+        GameHost(const GameHost&) = delete;
+        GameHost& operator=(const GameHost&) = delete;
+
+        // Adds a game, which starts at once if a worker is free. onEnd is called on a
+        // worker when it ends, and may add another game. Returns the id of the game,
+        // or 0 if the host has stopped.
+        // Throws std::invalid_argument if the size or the opening is not legal.
+        long long addGame(const GameSettings& settings, std::function<void(const Result&)> onEnd = nullptr) {
+            std::unique_ptr<Game> game(new Game());
+            game->board.reset(new Othello(settings.size, placeholder, placeholder));
+            for (size_t i = 0; i < settings.opening.size(); i++) {
+                const Point& move = settings.opening[i];
+                if (!game->board->getMoves(game->board->turn).contains(move)) throw std::invalid_argument("Illegal move in an opening");
+                game->board->playPiece(game->board->turn, move.x, move.y, false);
+                game->board->switchTurn();
+            }
+            game->settings = settings;
+            game->onEnd = onEnd;
+            game->remaining[black] = game->remaining[white] = settings.budget;
+
+            std::lock_guard<std::mutex> guard(lock);
+            if (stopping) return 0;
+            long long id = game->id = game->result.id = nextId++;
+            game->waiting = std::chrono::steady_clock::now();
+            queue.push_back(std::move(game));
+            active++;
+            gameReady.notify_one();
+            return id;
+        }
+
+        // Games waiting for a move or being played.
+        long long activeGames() const {
+            return active;
+        }
+
+        // Returns what the host did since the last call, and starts counting again.
+        // Moves being played are counted with the next call.
+        Stats takeStats() {
+            std::lock_guard<std::mutex> guard(lock);
+            Stats taken;
+            std::swap(taken, stats);
+            return taken;
+        }
+
+        // Cancels the running searches, drops every game without calling its onEnd,
+        // and waits for the workers to end.
+        void stop() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            gameReady.notify_all();
+            for (size_t i = 0; i < workers.size(); i++) {
+                if (workers[i].joinable()) workers[i].join();
+            }
+
+            std::lock_guard<std::mutex> guard(lock);
+            queue.clear();
+            active = 0;
+        }
+    };
+}
@@ -0,0 +1,373 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <mutex>
+#include <chrono>
+#include <ctime>
+#include <stdexcept>
+#include <cstdint>
+#include "othello.h"
+#include "othobserver.h"
+#include "mappedfile.h"
+
+namespace oth {
+    /*
+        One finished game: who played it, how it ended, how long it took, and its moves.
+
+        Archives of games are files of records written one after another, so games
+        are only ever appended. A file starts with "OTHR", the version and 3 unused
+        bytes. Every record is, little endian:
+            record length after these 2 bytes (2 bytes)
+            board size (1 byte), flags (1 byte): bit 0 if white moved first,
+                bit 1 if the game started from its own position
+            final discs of black and white (2 bytes each)
+            start time in seconds since 1970 (8 bytes)
+            milliseconds of the game, of black, and of white (4 bytes each)
+            names of the black and white engines (1 byte length, then the text, each)
+            start position if flag bit 1, 2 bits per cell row by row: 0 empty, 1 black, 2 white
+            move count (2 bytes)
+            moves, y * size + x, in 1 byte if the board has less than 256 cells, or 2 bytes
+
+        Passes are not stored. A side without moves passes when the game is replayed.
+    */
+    struct GameRecord {
+
+        const static int VERSION = 1;
+        const static int FILEHEADERSIZE = 8;
+
+        int size = 8;
+        Color firstTurn = black;
+
+        // Cells as in Othello::setPosition, or empty if the game started from the usual position.
+        std::string start;
+
+        std::string blackName;
+        std::string whiteName;
+        int blackDiscs = 0;
+        int whiteDiscs = 0;
+
+        int64_t startTime = 0;
+        uint32_t milliseconds = 0;
+        // Thinking time of black and white, in milliseconds.
+        uint32_t blackMilliseconds = 0;
+        uint32_t whiteMilliseconds = 0;
+
+        std::vector<Point> moves;
+
+        // Cells of the usual start position on a board of size, as in Othello::setPosition.
+        static std::string usualStart(int size) {
+            std::string cells(size * size, '-');
+            int half = size / 2;
+            cells[(half - 1) * size + half - 1] = cells[half * size + half] = 'O';
+            cells[(half - 1) * size + half] = cells[half * size + half - 1] = 'X';
+            return cells;
+        }
+
+        // Bytes of every move on this board size.
+        int moveBytes() const {
+            return size * size < 256 ? 1 : 2;
+        }
+
+        // Adds the record to bytes.
+        void serialize(std::vector<unsigned char>& bytes) const {
+            size_t at = bytes.size();
+            write(bytes, 0, 2);
+
+            bytes.push_back(size);
+            bytes.push_back((firstTurn == white ? 1 : 0) | (start.empty() ? 0 : 2));
+            write(bytes, blackDiscs, 2);
+            write(bytes, whiteDiscs, 2);
+            write(bytes, (uint64_t)startTime, 8);
+            write(bytes, milliseconds, 4);
+            write(bytes, blackMilliseconds, 4);
+            write(bytes, whiteMilliseconds, 4);
+            writeName(bytes, blackName);
+            writeName(bytes, whiteName);
+
+            if (!start.empty()) {
+                size_t first = bytes.size();
+                bytes.resize(first + (size * size + 3) / 4, 0);
+                for (int i = 0; i < size * size; i++) {
+                    char c = start[i];
+                    int cell = c == 'X' || c == 'x' || c == '*' ? black : c == 'O' || c == 'o' ? white : none;
+                    bytes[first + i / 4] |= cell << (i % 4 * 2);
+                }
+            }
+
+            write(bytes, moves.size(), 2);
+            for (size_t i = 0; i < moves.size(); i++) write(bytes, moves[i].y * size + moves[i].x, moveBytes());
+
+            size_t length = bytes.size() - at - 2;
+            if (length > 0xffff) throw std::length_error("Game record is too long");
+            bytes[at] = length & 0xff;
+            bytes[at + 1] = length >> 8;
+        }
+
+        // Reads the record at bytes, which has length bytes left, and returns its size
+        // with the length field. Throws std::runtime_error if it is cut or not a record.
+        size_t deserialize(const unsigned char* bytes, size_t length) {
+            if (length < 2) throw std::runtime_error("Game record is cut");
+            size_t total = read(bytes, 2) + 2;
+            if (total > length) throw std::runtime_error("Game record is cut");
+
+            const unsigned char* at = bytes + 2;
+            const unsigned char* end = bytes + total;
+            auto take = [&](int count) {
+                if (end - at < count) throw std::runtime_error("Game record is cut");
+                uint64_t value = read(at, count);
+                at += count;
+                return value;
+            };
+
+            size = take(1);
+            if (size < 4 || size > Othello::MAXSIZE) throw std::runtime_error("Game record has a bad board size");
+            int flags = take(1);
+            firstTurn = flags & 1 ? white : black;
+            blackDiscs = take(2);
+            whiteDiscs = take(2);
+            startTime = (int64_t)take(8);
+            milliseconds = take(4);
+            blackMilliseconds = take(4);
+            whiteMilliseconds = take(4);
+
+            for (int n = 0; n < 2; n++) {
+                int count = take(1);
+                if (end - at < count) throw std::runtime_error("Game record is cut");
+                (n == 0 ? blackName : whiteName).assign((const char*)at, count);
+                at += count;
+            }
+
+            start.clear();
+            if (flags & 2) {
+                int cells = size * size;
+                if (end - at < (cells + 3) / 4) throw std::runtime_error("Game record is cut");
+                start.resize(cells);
+                for (int i = 0; i < cells; i++) {
+                    int cell = (at[i / 4] >> (i % 4 * 2)) & 3;
+                    start[i] = cell == black ? 'X' : cell == white ? 'O' : '-';
+                }
+                at += (cells + 3) / 4;
+            }
+
+            int count = take(2);
+            moves.resize(count);
+            for (int i = 0; i < count; i++) {
+                int square = take(moveBytes());
+                if (square >= size * size) throw std::runtime_error("Game record has a move off the board");
+                moves[i] = Point(square % size, square / size);
+            }
+
+            return total;
+        }
+
+        // Plays the game again on board, which must have the size of the record, and shows
+        // it to observer. Passes are played where a side has no moves. The moves are in
+        // the undo stack. Throws std::runtime_error if a move is not legal.
+        void replay(Othello& board, GameObserver& observer) const {
+            if (board.size != size) throw std::runtime_error("Game record is for another board size");
+
+            board.setPosition(start.empty() ? usualStart(size) : start, firstTurn);
+            observer.gameStarted(board);
+
+            for (size_t i = 0; i < moves.size(); i++) {
+                if (board.getMoves(board.turn).empty()) {
+                    observer.passed(board, board.turn);
+                    board.switchTurn();
+                }
+                if (!board.getMoves(board.turn).contains(moves[i])) throw std::runtime_error("Game record has an illegal move");
+
+                Color color = board.turn;
+                board.playPiece(color, moves[i].x, moves[i].y, true);
+                observer.movePlayed(board, color, moves[i]);
+                board.switchTurn();
+            }
+
+            observer.gameOver(board);
+        }
+
+private:
+
+        static uint64_t read(const unsigned char* bytes, int length) {
+            uint64_t value = 0;
+            for (int i = length - 1; i >= 0; i--) value = (value << 8) | bytes[i];
+            return value;
+        }
+
+        static void write(std::vector<unsigned char>& bytes, uint64_t value, int length) {
+            for (int i = 0; i < length; i++) bytes.push_back((value >> (i * 8)) & 0xff);
+        }
+
+        static void writeName(std::vector<unsigned char>& bytes, const std::string& name) {
+            size_t length = name.size() < 255 ? name.size() : 255;
+            bytes.push_back(length);
+            bytes.insert(bytes.end(), name.begin(), name.begin() + length);
+        }
+    };
+
+    /*
+        Appends game records to an archive file. Games can be written from many
+        threads at once, and each one goes to the file in one write.
+    */
+    class GameWriter {
+
+        std::ofstream out;
+        std::mutex lock;
+
+        // Record being serialized, kept so writing doesn't allocate.
+        std::vector<unsigned char> bytes;
+
+public:
+
+        // Opens the archive, and makes it if it doesn't exist.
+        // Throws std::runtime_error if it can't be written, or is not an archive.
+        explicit GameWriter(const std::string& path) {
+            std::ifstream existing(path, std::ios::binary);
+            char header[GameRecord::FILEHEADERSIZE];
+            bool empty = !existing || !existing.read(header, 1);
+            if (!empty) {
+                existing.seekg(0);
+                if (!existing.read(header, sizeof(header)) || std::string(header, 4) != "OTHR") {
+                    throw std::runtime_error(path + " is not a game archive");
+                }
+                if (header[4] != GameRecord::VERSION) throw std::runtime_error(path + " is an archive of another version");
+            }
+            existing.close();
+
+            out.open(path, std::ios::binary | std::ios::app);
+            if (!out) throw std::runtime_error("Can't write " + path);
+            if (empty) out.write("OTHR\x01\0\0\0", GameRecord::FILEHEADERSIZE);
+        }
+
+        void write(const GameRecord& record) {
+            std::lock_guard<std::mutex> guard(lock);
+            bytes.clear();
+            record.serialize(bytes);
+            out.write((const char*)bytes.data(), bytes.size());
+        }
+
+        // Sends the written games to the file.
+        void flush() {
+            std::lock_guard<std::mutex> guard(lock);
+            out.flush();
+        }
+    };
+
+    /*
+        Reads the games of an archive one after another. The file is mapped into
+        memory, so archives of any size open at once and are read at the speed
+        of memory.
+    */
+    class GameReader {
+
+        MappedFile file;
+        size_t offset = GameRecord::FILEHEADERSIZE;
+
+public:
+
+        // Throws std::runtime_error if the file can't be read or is not an archive.
+        explicit GameReader(const std::string& path) : file(path) {
+            const unsigned char* bytes = file.data();
+            if (file.size() < GameRecord::FILEHEADERSIZE || std::string((const char*)bytes, 4) != "OTHR") {
+                throw std::runtime_error(path + " is not a game archive");
+            }
+            if (bytes[4] != GameRecord::VERSION) throw std::runtime_error(path + " is an archive of another version");
+        }
+
+        // Reads the next game. Returns false after the last one.
+        // Throws std::runtime_error if the record is cut or broken.
+        bool next(GameRecord& record) {
+            if (offset >= file.size()) return false;
+            offset += record.deserialize(file.data() + offset, file.size() - offset);
+            return true;
+        }
+
+        // Goes back to the first game.
+        void rewind() {
+            offset = GameRecord::FILEHEADERSIZE;
+        }
+
+        // Bytes read so far, and in the whole archive.
+        size_t position() const {
+            return offset;
+        }
+
+        size_t size() const {
+            return file.size();
+        }
+    };
+
+    /*
+        Records the game it observes, and writes it to an archive at the end.
+        The engine names are not known to the board, so they are set by the caller.
+    */
+    class GameRecorder : public GameObserver {
+
+        GameWriter& writer;
+        GameRecord record;
+        std::chrono::steady_clock::time_point gameStart;
+        std::chrono::steady_clock::time_point turnStart;
+        double thinking[2];
+
+        static uint32_t elapsed(std::chrono::steady_clock::time_point since) {
+            return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - since).count();
+        }
+
+public:
+
+        std::string blackName;
+        std::string whiteName;
+
+        GameRecorder(GameWriter& writer) : writer(writer) {}
+
+        // Moves in the undo stack of board, like an opening played before the game,
+        // are recorded as the first moves of the game.
+        void gameStarted(Othello& board) {
+            record.size = board.size;
+            record.blackName = blackName;
+            record.whiteName = whiteName;
+            record.startTime = (int64_t)std::time(nullptr);
+            thinking[0] = thinking[1] = 0;
+            gameStart = std::chrono::steady_clock::now();
+
+            record.moves.clear();
+            record.firstTurn = board.turn;
+            Othello first(board);
+            if (!board.undos.empty()) {
+                record.firstTurn = board.undos[0].played;
+                for (size_t i = 0; i < board.undos.size(); i++) record.moves.push_back(board.undos[i].coor);
+                while (!first.undos.empty()) first.undoMove();
+            }
+
+            // Games from the usual position don't need it stored.
+            record.start.clear();
+            for (int y = 0; y < first.size; y++) {
+                for (int x = 0; x < first.size; x++) {
+                    Color c = first.at(x, y);
+                    record.start += c == black ? 'X' : c == white ? 'O' : '-';
+                }
+            }
+            if (record.start == GameRecord::usualStart(first.size)) record.start.clear();
+        }
+
+        void turnStarted(Othello& board) {
+            turnStart = std::chrono::steady_clock::now();
+        }
+
+        void movePlayed(Othello& board, Color color, Point move) {
+            thinking[color == white] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - turnStart).count();
+            record.moves.push_back(move);
+        }
+
+        void gameOver(Othello& board) {
+            record.blackDiscs = board.getScore(black);
+            record.whiteDiscs = board.getScore(white);
+            record.milliseconds = elapsed(gameStart);
+            record.blackMilliseconds = (uint32_t)thinking[0];
+            record.whiteMilliseconds = (uint32_t)thinking[1];
+            writer.write(record);
+        }
+    };
+}
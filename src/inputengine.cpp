@@ -1,5 +1,4 @@
 #include "othengine.h"
-#include <list>
 #include <iostream>
 #include <string>
 #include <regex>
@@ -37,19 +36,8 @@ namespace oth {
                     int x = std::stoi(rmatch[1]) - 1;
                     int y = std::stoi(rmatch[2]) - 1;
 
-                    // Get the valid moves for the color
-                    std::list<Point>* move;
-                    switch(board.turn) {
-                        case (white):
-                            move = &board.whiteMove;
-                            break;
-                        case (black):
-                            move = &board.blackMove;
-                            break;
-                    }
-
                     // Check if the input is in the possible moves
-                    if (std::any_of(move->begin(), move->end(), [x, y](Point& p) { return (p.x == x && p.y == y); })) {
+                    if (board.getMoves(board.turn).contains(Point(x, y))) {
                         return Point(x, y);
                     }
                 }
@@ -0,0 +1,64 @@
+#include "othobserver.h"
+#include "othello.h"
+#include <iostream>
+#include <string>
+
+namespace oth {
+    /*
+        Writes the game as plain lines of text, without boards, for log files.
+        Lines end with '\n' and the stream is never flushed, so a log costs
+        no more than the stream's own buffering.
+    */
+    class LogObserver : public GameObserver {
+
+        std::ostream& out;
+
+        // Line being built.
+        std::string line;
+
+        static const char* name(Color color) {
+            return color == white ? "white" : "black";
+        }
+
+        void score(Othello& board) {
+            line += "black " + std::to_string(board.getScore(black)) + " white " + std::to_string(board.getScore(white));
+        }
+
+        void write() {
+            line += '\n';
+            out.write(line.data(), line.size());
+            line.clear();
+        }
+
+public:
+
+        LogObserver(std::ostream& out) : out(out) {}
+
+        void gameStarted(Othello& board) {
+            line += "start " + std::to_string(board.size) + "x" + std::to_string(board.size) + " " + name(board.turn) + " to move, ";
+            score(board);
+            write();
+        }
+
+        void movePlayed(Othello& board, Color color, Point move) {
+            line += std::string(name(color)) + " (" + std::to_string(move.x + 1) + ", " + std::to_string(move.y + 1) + ")";
+            write();
+        }
+
+        void passed(Othello& board, Color color) {
+            line += std::string(name(color)) + " pass";
+            write();
+        }
+
+        void gameOver(Othello& board) {
+            line += "end ";
+            score(board);
+            write();
+        }
+
+        void message(const std::string& text) {
+            line += "info " + text;
+            write();
+        }
+    };
+}
@@ -2,6 +2,10 @@
 #include "randomengine.cpp"
 #include "minimaxengine.cpp"
 #include "inputengine.cpp"
+#include "terminalobserver.cpp"
+#include "evaluator.h"
+#include "gamerecord.h"
+#include <memory>
 #include <stdlib.h>
 #include <time.h>
 
@@ -10,15 +14,48 @@ int main() {
 
     srand(time(NULL)); // TODO: Change this
 
-    std::cout << "Welcome to othello! The white piece will be \n";
-    std::cout << "played by a random engine, while the black piece will be \n";
-    std::cout << "played by minimax algorithm with 3 recursion depths.\n" << std::endl;
-
-    oth::MinimaxEngine en1 = oth::MinimaxEngine();
+    oth::MinimaxEngine en1;
+    // Think while the player does, so guessed moves are answered at once.
+    en1.ponder = true;
     oth::InputEngine en2 = oth::InputEngine();
 
+    // Use pattern weights from tools/trainpatterns if there are any, or count discs.
+    try {
+        en1.setEvaluator(std::make_shared<oth::PatternEvaluator>(oth::PatternEvaluator::load("patterns.bin")));
+    } catch (const std::runtime_error&) {}
+
+    // Play the openings of tools/buildbook without thinking, if there is a book.
+    try {
+        en1.setBook(oth::OpeningBook::open("book.bin"));
+    } catch (const std::runtime_error&) {}
+
+    // Prune with the Multi-ProbCut fit of tools/fitprobcut, if there is one.
+    try {
+        en1.setProbCut(std::make_shared<oth::ProbCut>(oth::ProbCut::load("probcut.bin")));
+    } catch (const std::runtime_error&) {}
+
+    oth::TerminalObserver terminal;
+    terminal.header =
+        "Welcome to othello! You play the white piece, \n"
+        "while the black piece will be played by minimax \n"
+        "algorithm, thinking for a second per move.\n\n";
+    // terminal.pauseEveryTurn = false;
+
     oth::Othello board(8, en2, en1);
-    // board.pauseEveryTurn = false;
+    board.setObserver(terminal);
+
+    // Add the game to games.bin, which tools/records lists and replays.
+    std::unique_ptr<oth::GameWriter> archive;
+    std::unique_ptr<oth::GameRecorder> recorder;
+    std::unique_ptr<oth::SplitObserver> recorded;
+    try {
+        archive.reset(new oth::GameWriter("games.bin"));
+        recorder.reset(new oth::GameRecorder(*archive));
+        recorder->blackName = "minimax";
+        recorder->whiteName = "player";
+        recorded.reset(new oth::SplitObserver(terminal, *recorder));
+        board.setObserver(*recorded);
+    } catch (const std::runtime_error&) {}
 
     board.startGame(oth::black);
 
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace oth {
+    /*
+        A whole file mapped read only into memory. Pages are loaded by the system
+        when they are first read, and every process mapping the same file shares them.
+    */
+    class MappedFile {
+
+        const unsigned char* bytes = nullptr;
+        size_t length = 0;
+
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = NULL;
+#endif
+
+        void close() {
+#ifdef _WIN32
+            if (bytes) UnmapViewOfFile(bytes);
+            if (mapping) CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+            mapping = NULL;
+#else
+            if (bytes) munmap((void*)bytes, length);
+#endif
+            bytes = nullptr;
+            length = 0;
+        }
+
+public:
+
+        // Maps the file. Throws std::runtime_error if it can't be opened.
+        // An empty file maps to no bytes.
+        explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Can't open " + path);
+
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize)) {
+                close();
+                throw std::runtime_error("Can't read the size of " + path);
+            }
+            length = (size_t)fileSize.QuadPart;
+            if (length == 0) return;
+
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping) bytes = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (!bytes) {
+                close();
+                throw std::runtime_error("Can't map " + path);
+            }
+#else
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) throw std::runtime_error("Can't open " + path);
+
+            struct stat info;
+            if (fstat(fd, &info) != 0) {
+                ::close(fd);
+                throw std::runtime_error("Can't read the size of " + path);
+            }
+            length = (size_t)info.st_size;
+
+            if (length > 0) {
+                void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+                if (mapped == MAP_FAILED) {
+                    ::close(fd);
+                    length = 0;
+                    throw std::runtime_error("Can't map " + path);
+                }
+                bytes = (const unsigned char*)mapped;
+            }
+
+            // The mapping stays valid without the descriptor.
+            ::close(fd);
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile() {
+            close();
+        }
+
+        const unsigned char* data() const {
+            return bytes;
+        }
+
+        size_t size() const {
+            return length;
+        }
+    };
+}
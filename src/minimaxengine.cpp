@@ -1,143 +1,944 @@
 #include "othengine.h"
+#include "transposition.h"
+#include "searchstats.h"
+#include "evaluator.h"
+#include "endgame.h"
+#include "book.h"
+#include "probcut.h"
+#include <cmath>
 #include <stdlib.h>
-#include <list>
+#include <vector>
+#include <memory>
 #include <algorithm>
-#include <iostream>
+#include <string>
+#include <ostream>
 #include <limits>
 #include <chrono>
+#include <atomic>
+#include <thread>
+#include <functional>
 
-#define RECURDEPTH 4
+#define MAXDEPTH 64
 #define SCORE int
 
 namespace oth {
     class MinimaxEngine : public Engine {
 
 private:
-        
-        // Color of the tile that we would like to calculate for, and win
-        Color winColor;
-        int movesForeseen;
-        Point chosenSquare;
 
-        // Store board reference
-        Othello* board;
+        // A move, with the priority it gets searched with.
+        struct OrderedMove {
+            Point move;
+            // Higher is searched first.
+            int priority;
+            // Position in the board's move list, used to break ties like plain minimax.
+            int index;
+        };
 
+        // Move ordering bonuses.
+        const static int PVBONUS = 1 << 29;
+        const static int HASHBONUS = 1 << 28;
+        const static int CORNERBONUS = 1 << 24;
+        const static int KILLERBONUS = 1 << 20;
 
-        // Utility to do minimax
-        // curDepth: the current depth of the recursion
-        // isMaxing: whether the current step is maximizing or minimizing
-        SCORE minimaxRecur(int curDepth, bool isMaxing) {
-            movesForeseen++;
+        // Bigger than any score, and safe to negate.
+        const static SCORE INF = std::numeric_limits<SCORE>::max();
 
-            // Switch the turn every time minimax is called.
-            board->switchTurn();
-            
-            // When recursion have reached max depth
-            if (curDepth == RECURDEPTH) {
-                // Score at the current step
-                int score = board->getScore(winColor);
+        // Iterations searched before the solver takes over at the root.
+        const static int ITERATIONSBEFORESOLVING = 8;
 
-                // Don't forget to undo the move when returning something.
-                board->undoMove();
-                return score;
+        // Nodes between two checks of the clock.
+        const static int CHECKINTERVAL = 1024;
+
+        /*
+            Search state of one thread. Every worker searches its own copy of the board,
+            and they only share the transposition table (lazy SMP).
+        */
+        struct Worker {
+            MinimaxEngine* engine;
+
+            // Worker 0 is the main one, whose result is played.
+            int id;
+
+            // Store board reference
+            Othello* board;
+
+            long long movesForeseen;
+            Point chosenSquare;
+            int depthReached;
+
+            // Set when a leaf was cut by depth, so the iteration is not an exact result.
+            bool horizon;
+
+            // Ordered moves of every ply, one after another. Ply p starts at p * size * size,
+            // so nodes never allocate.
+            std::vector<OrderedMove> moveStack;
+
+            // Two killer moves for every ply.
+            std::vector<Point> killers;
+
+            // History heuristic, indexed by y * size + x.
+            std::vector<int> history;
+
+            // Triangular table of principal variations. Row ply starts at ply * (MAXDEPTH + 1).
+            // Passes are stored as (-1, -1).
+            std::vector<Point> pvTable;
+            std::vector<int> pvLength;
+
+            // Best line of the previous iteration, searched first by the next one.
+            std::vector<Point> prevPv;
+            bool followPv;
+
+            TranspositionTable::Stats tableStats;
+
+            // Search statistics of the current move.
+            long long expandedNodes;
+            long long cutoffs[SearchStats::CUTOFFSLOTS];
+            long long probCuts;
+
+            // Ply of the node whose shallow searches probCut runs, or -1. They don't cut
+            // again, and don't store that node, which has a deeper entry to keep.
+            int probedPly = -1;
+
+            // Iterations of the current move. Entries past iterationCount are kept,
+            // so their lines don't allocate again.
+            std::vector<SearchStats::Iteration> iterations;
+            int iterationCount;
+
+            // Exact solver of the last empties, made by the first search that can use it.
+            std::unique_ptr<EndgameSolver> solver;
+
+            Worker(MinimaxEngine* engine, int id) : engine(engine), id(id) {}
+
+            // Score of the current board, seen from the color whose turn it is.
+            // It doesn't depend on winColor, so table entries stay valid
+            // whichever color the engine plays.
+            SCORE evaluate() {
+                if (engine->useEvaluator) return engine->evaluator->evaluate(*board);
+                return finalScore();
+            }
+
+            // Exact score of a finished game, in the same units as evaluate.
+            SCORE finalScore() {
+                Color opp = board->turn == white ? black : white;
+                SCORE diff = board->getScore(board->turn) - board->getScore(opp);
+                return engine->useEvaluator ? diff * PatternEvaluator::SCALE : diff;
+            }
+
+            bool isCorner(const Point& p) {
+                int last = board->size - 1;
+                return (p.x == 0 || p.x == last) && (p.y == 0 || p.y == last);
+            }
+
+            // Copies the moves of the current turn to the ply buffer, and sorts them.
+            // Returns the buffer, and puts the number of moves in count.
+            OrderedMove* orderMoves(int ply, const Point& hashMove, const Point& pvMove, int& count) {
+                OrderedMove* moves = &moveStack[ply * board->size * board->size];
+
+                const MoveList& valid = board->getMoves(board->turn);
+                count = valid.size();
+                for (int i = 0; i < count; i++) {
+                    const Point& move = valid[i];
+                    OrderedMove& om = moves[i];
+                    om.move = move;
+                    om.index = i;
+                    om.priority = history[move.y * board->size + move.x];
+                    if (move == pvMove) om.priority += PVBONUS;
+                    if (move == hashMove) om.priority += HASHBONUS;
+                    if (isCorner(move)) om.priority += CORNERBONUS;
+                    if (move == killers[ply*2] || move == killers[ply*2 + 1]) om.priority += KILLERBONUS;
+                }
+
+                // Lists are short, so a stable insertion sort is enough.
+                for (int i = 1; i < count; i++) {
+                    OrderedMove cur = moves[i];
+                    int j = i;
+                    for (; j > 0 && moves[j-1].priority < cur.priority; j--) moves[j] = moves[j-1];
+                    moves[j] = cur;
+                }
+
+                return moves;
+            }
+
+            // Remembers a move that caused a beta cutoff.
+            void storeCutoff(const Point& move, int ply, int depth) {
+                history[move.y * board->size + move.x] += depth * depth;
+
+                if (killers[ply*2] != move) {
+                    killers[ply*2 + 1] = killers[ply*2];
+                    killers[ply*2] = move;
+                }
+            }
+
+            // Adds searched nodes to the shared count, and stops every worker if a limit is hit.
+            bool addNodes(long long searched) {
+                long long nodes = engine->nodes.fetch_add(searched, std::memory_order_relaxed) + searched;
+                const SearchLimits& limits = engine->limits;
+
+                if (engine->cancel && engine->cancel->load(std::memory_order_relaxed)) engine->stopped = true;
+
+                // A ponder search only stops when told to. Once it is hit, its limits
+                // count from when it started, so the opponent's time is not lost.
+                if (engine->pondering.load(std::memory_order_acquire)) return engine->stopped.load(std::memory_order_relaxed);
+
+                if (limits.nodes > 0 && nodes >= limits.nodes) engine->stopped = true;
+
+                if (limits.moveTime > 0) {
+                    auto elapsed = std::chrono::steady_clock::now() - engine->startTime;
+                    if (elapsed >= std::chrono::milliseconds(limits.moveTime)) engine->stopped = true;
+                }
+
+                return engine->stopped.load(std::memory_order_relaxed);
+            }
+
+            // Stops every worker, if a limit is hit.
+            // The shared node count is only updated every CHECKINTERVAL nodes.
+            bool checkLimits() {
+                if (movesForeseen % CHECKINTERVAL == 0) addNodes(CHECKINTERVAL);
+                return engine->stopped.load(std::memory_order_relaxed);
+            }
+
+            // Empty squares left on the board.
+            int empties() {
+                return board->size * board->size - board->getScore(white) - board->getScore(black);
+            }
+
+            // Whether the solver should take over a node with depth plies left,
+            // which happens when the search would go to the end of the game anyway.
+            bool shouldSolve(int depth) {
+                if (!engine->solving) return false;
+                int left = empties();
+                return left <= engine->endgameEmpties && depth >= left;
+            }
+
+            // Exact score of the current board with the solver, in the units of evaluate.
+            // Outside (alpha, beta), the score is a bound like the one of pvs.
+            // best gets the best move, or (-1, -1) for a pass.
+            SCORE solve(SCORE alpha, SCORE beta, Point& best) {
+                // Disc window that holds (alpha, beta) in any units.
+                int scale = engine->useEvaluator ? PatternEvaluator::SCALE : 1;
+                long long low = alpha >= 0 ? alpha / scale : -((-(long long)alpha + scale - 1) / scale);
+                long long high = beta >= 0 ? ((long long)beta + scale - 1) / scale : -(-(long long)beta / scale);
+                int a = low < -65 ? -65 : low > 65 ? 65 : low;
+                int b = high < -65 ? -65 : high > 65 ? 65 : high;
+
+                Color opp = board->turn == white ? black : white;
+                long long before = solver->nodes;
+                int square;
+                int score = solver->solve(board->getDiscs(board->turn), board->getDiscs(opp), a, b, square);
+                movesForeseen += solver->nodes - before;
+
+                best = square < 0 ? Point(-1, -1) : Point(square % 8, square / 8);
+                return score * scale;
+            }
+
+            // Sets the principal variation of ply to move, followed by the one of ply + 1.
+            void updatePv(int ply, const Point& move) {
+                Point* row = &pvTable[ply * (MAXDEPTH + 1)];
+                const Point* next = &pvTable[(ply + 1) * (MAXDEPTH + 1)];
+
+                row[0] = move;
+                for (int i = 0; i < pvLength[ply + 1]; i++) row[i + 1] = next[i];
+                pvLength[ply] = pvLength[ply + 1] + 1;
             }
 
-            // Choose the moves depending on the current color.
-            std::list<Point> move;
-            switch(board->turn) {
-                case (white):
-                    move = board->whiteMove;
-                    break;
-                case (black):
-                    move = board->blackMove;
-                    break;
+            // Move of the previous best line at ply, if the search is still following it.
+            Point pvMoveAt(int ply, bool onPv) {
+                if (onPv && ply < (int)prevPv.size()) return prevPv[ply];
+                return Point(-1, -1);
             }
 
-            // Create an array to contain all the score values
-            const int validMoves = move.size();
-            SCORE* vals = new SCORE[validMoves];
-            int valI = 0;
+            // Multi-ProbCut: a shallow search predicts the score of the deep one. When the
+            // prediction is outside (alpha, beta) by more than threshold standard deviations,
+            // the deep search would almost surely fail the same way, so it is skipped.
+            // Returns whether the node is cut, with its score in result.
+            bool probCut(int depth, int ply, SCORE alpha, SCORE beta, bool passed, SCORE& result) {
+                const ProbCut::Pair* pair = engine->probCut->find(board->getScore(white) + board->getScore(black), depth);
+                if (!pair) return false;
 
-            // Iterate every of the current move
-            for (std::list<Point>::const_iterator it = move.begin(); it != move.end(); ++it) {
-                // Play the piece, as if playing self
-                // Dont forget to enable undoing
-                board->playPiece(board->turn, (*it).x, (*it).y, true);
+                // The parameters are in discs.
+                double scale = engine->useEvaluator ? PatternEvaluator::SCALE : 1;
+                double margin = engine->probCutThreshold * pair->sigma * scale;
+                double limit = board->size * board->size * scale;
+                bool cut = false;
 
-                // Recur, depending when we want to maximize or minimize
-                vals[valI++] = minimaxRecur(curDepth+1, !isMaxing);
+                probedPly = ply;
+
+                // deep >= beta is likely when a * shallow + b - margin >= beta.
+                double high = std::ceil((beta + margin - pair->b * scale) / pair->a);
+                if (beta < INF && high <= limit) {
+                    SCORE bound = (SCORE)high;
+                    if (pvs(pair->shallow, ply, bound - 1, bound, passed) >= bound) {
+                        result = beta;
+                        cut = true;
+                    }
+                }
+
+                // deep <= alpha is likely when a * shallow + b + margin <= alpha.
+                double low = std::floor((alpha - margin - pair->b * scale) / pair->a);
+                if (!cut && alpha > -INF && low >= -limit) {
+                    SCORE bound = (SCORE)low;
+                    if (pvs(pair->shallow, ply, bound, bound + 1, passed) <= bound) {
+                        result = alpha;
+                        cut = true;
+                    }
+                }
+
+                probedPly = -1;
+                if (cut) probCuts++;
+                return cut;
+            }
+
+            // Plays the move for the current turn, and gives the turn to the opponent.
+            void makeMove(const Point& move) {
+                board->playPiece(board->turn, move.x, move.y, true);
+                board->switchTurn();
             }
 
-            SCORE minMaxValue;
-            // Check if there is any valid moves
-            if (validMoves > 0) {
-                
-                // Store pointer temporarily
-                // Get the minimum / maximum depending on the state.
-                SCORE* tempVal = isMaxing ? 
-                    std::max_element(vals, vals+validMoves-1):
-                    std::min_element(vals, vals+validMoves-1);
+            // Principal variation search, in negamax form.
+            // depth: how many plies are left to search
+            // ply: how many plies away from the root
+            // passed: whether the previous ply was a pass
+            SCORE pvs(int depth, int ply, SCORE alpha, SCORE beta, bool passed) {
+                movesForeseen++;
+                pvLength[ply] = 0;
+
+                // Only the first move of a node on the previous best line stays on it.
+                bool onPv = followPv;
+                followPv = false;
+
+                if (checkLimits()) return 0;
+
+                // When recursion have reached max depth
+                if (depth == 0) {
+                    horizon = true;
+                    return evaluate();
+                }
+
+                if (shouldSolve(depth)) {
+                    Point best;
+                    return solve(alpha, beta, best);
+                }
+
+                // Use the table when this position was already searched deep enough.
+                SCORE alphaOrig = alpha;
+                uint64_t key = board->getHash();
+                Point hashMove(-1, -1);
+                TranspositionTable::Entry entry;
+                if (engine->table->probe(key, entry, tableStats)) {
+                    hashMove = entry.move;
+                    if (entry.depth >= depth && !onPv) {
+                        // The entry may come from a search that was cut by depth.
+                        horizon = true;
+                        if (entry.bound == TranspositionTable::EXACT) return entry.score;
+                        if (entry.bound == TranspositionTable::LOWER && entry.score >= beta) return entry.score;
+                        if (entry.bound == TranspositionTable::UPPER && entry.score <= alpha) return entry.score;
+                    }
+                }
+
+                // Lines off the previous best one are pruned by their shallow searches.
+                if (engine->useProbCut && !onPv && probedPly < 0) {
+                    SCORE result;
+                    if (probCut(depth, ply, alpha, beta, passed, result)) return result;
+                    if (engine->stopped.load(std::memory_order_relaxed)) return 0;
+                }
+
+                int count;
+                OrderedMove* moves = orderMoves(ply, hashMove, pvMoveAt(ply, onPv), count);
+
+                // No moves means a pass, and two passes in a row end the game.
+                if (count == 0) {
+                    if (passed) return finalScore();
+
+                    board->switchTurn();
+                    followPv = onPv;
+                    SCORE score = -pvs(depth - 1, ply + 1, -beta, -alpha, true);
+                    board->switchTurn();
+
+                    updatePv(ply, Point(-1, -1));
+                    return score;
+                }
+
+                expandedNodes++;
+
+                SCORE best = -INF;
+                Point bestMove(-1, -1);
+                for (int i = 0; i < count; i++) {
+                    Point move = moves[i].move;
+                    makeMove(move);
+
+                    SCORE score;
+                    if (i == 0) {
+                        // Search the first move with the full window.
+                        followPv = onPv;
+                        score = -pvs(depth - 1, ply + 1, -beta, -alpha, false);
+                    } else {
+                        // Prove the rest are worse with a null window, and research if not.
+                        score = -pvs(depth - 1, ply + 1, -alpha - 1, -alpha, false);
+                        if (score > alpha && score < beta)
+                            score = -pvs(depth - 1, ply + 1, -beta, -score, false);
+                    }
+
+                    // Don't forget to undo the move.
+                    board->undoMove();
+
+                    // The score can't be trusted once the search is stopped.
+                    if (engine->stopped.load(std::memory_order_relaxed)) return 0;
+
+                    if (score > best) {
+                        best = score;
+                        bestMove = move;
+                        if (score > alpha) {
+                            alpha = score;
+                            updatePv(ply, move);
+                        }
+                        if (alpha >= beta) {
+                            storeCutoff(move, ply, depth);
+                            cutoffs[i < SearchStats::CUTOFFSLOTS ? i : SearchStats::CUTOFFSLOTS - 1]++;
+                            break;
+                        }
+                    }
+                }
+
+                TranspositionTable::Bound bound =
+                    best <= alphaOrig ? TranspositionTable::UPPER :
+                    best >= beta ? TranspositionTable::LOWER :
+                    TranspositionTable::EXACT;
+                if (ply != probedPly) engine->table->store(key, best, depth, bound, bestMove, tableStats);
+
+                return best;
+            }
+
+            // Searches the root to depth, and stores the best move in chosenSquare.
+            // Equal scores go to the move that comes first in the board's move list,
+            // so the same move as plain minimax is picked at equal depth.
+            // When the search is stopped, only the moves that were searched fully count.
+            SCORE searchRoot(int depth) {
+                movesForeseen++;
+                pvLength[0] = 0;
+
+                uint64_t key = board->getHash();
+                Point hashMove(-1, -1);
+                TranspositionTable::Entry entry;
+                if (engine->table->probe(key, entry, tableStats)) hashMove = entry.move;
+
+                int count;
+                OrderedMove* moves = orderMoves(0, hashMove, pvMoveAt(0, true), count);
+                expandedNodes++;
+
+                SCORE best = -INF;
+                int bestIndex = 0;
+                for (int i = 0; i < count; i++) {
+                    makeMove(moves[i].move);
+
+                    SCORE score;
+                    if (i == 0) {
+                        followPv = true;
+                        score = -pvs(depth - 1, 1, -INF, INF, false);
+                    } else {
+                        // A tie is only good enough if the move comes earlier in the list.
+                        SCORE bound = moves[i].index < bestIndex ? best - 1 : best;
+                        score = -pvs(depth - 1, 1, -bound - 1, -bound, false);
+                        if (score > bound)
+                            score = -pvs(depth - 1, 1, -INF, -bound, false);
+                    }
+
+                    board->undoMove();
+
+                    if (engine->stopped.load(std::memory_order_relaxed)) return best;
+
+                    if (i == 0 || score > best || (score == best && moves[i].index < bestIndex)) {
+                        best = score;
+                        bestIndex = moves[i].index;
+                        chosenSquare = moves[i].move;
+                        updatePv(0, chosenSquare);
+                    }
+                }
+
+                engine->table->store(key, best, depth, TranspositionTable::EXACT, chosenSquare, tableStats);
+
+                return best;
+            }
+
+            // Clears the statistics of the previous move.
+            void resetCounters() {
+                movesForeseen = 0;
+                depthReached = 0;
+                tableStats = TranspositionTable::Stats();
+                expandedNodes = 0;
+                for (int i = 0; i < SearchStats::CUTOFFSLOTS; i++) cutoffs[i] = 0;
+                probCuts = 0;
+                iterationCount = 0;
+            }
+
+            // Deepens one ply at a time on board, until a limit is hit or maxDepth is searched.
+            // Helpers start at alternating depths, so they don't all search the same tree.
+            void iterate(Othello& board, int maxDepth) {
+                this->board = &board;
+
+                // Reset the move ordering tables
+                resetCounters();
+                moveStack.resize((MAXDEPTH + 1) * board.size * board.size);
+                killers.assign((MAXDEPTH + 1) * 2, Point(-1, -1));
+                history.assign(board.size * board.size, 0);
+                pvTable.resize((MAXDEPTH + 1) * (MAXDEPTH + 1));
+                pvLength.assign(MAXDEPTH + 2, 0);
+                prevPv.clear();
+                if (engine->solving) {
+                    if (!solver) {
+                        solver.reset(new EndgameSolver());
+                        solver->poll = [this]() { return addNodes(EndgameSolver::POLLINTERVAL); };
+                    }
+                    solver->newSearch();
+                }
+
+                // Something is always returned, even if the first iteration is stopped.
+                chosenSquare = board.getMoves(board.turn).front();
+
+                // Close to the end, a few shallow iterations order the root moves and give
+                // a move if the solver runs out of time. Then the solver searches to the end.
+                int left = empties();
+                bool solveRoot = engine->solving && left <= engine->endgameEmpties && left <= maxDepth;
+
+                for (int depth = 1 + id % 2; depth <= maxDepth; depth++) {
+                    horizon = false;
+                    if (solveRoot && depth > ITERATIONSBEFORESOLVING && depth < left) depth = left;
+
+                    if (iterationCount == (int)iterations.size()) {
+                        iterations.emplace_back();
+                        iterations.back().pv.reserve(MAXDEPTH + 1);
+                    }
+                    SearchStats::Iteration& iteration = iterations[iterationCount++];
+                    iteration.depth = depth;
+                    iteration.nodes = movesForeseen;
+                    iteration.tableProbes = tableStats.probes;
+                    iteration.tableHits = tableStats.hits;
+                    auto start = std::chrono::steady_clock::now();
 
-                // Decide on where to go
-                if (curDepth == 0) {
+                    iteration.score = searchRoot(depth);
 
-                    // Choose from value
-                    std::list<Point>::const_iterator it = move.begin();
-                    // Do some pointer maths to get the list.
-                    std::advance(it, tempVal - vals);
-                    chosenSquare = *(it);
+                    iteration.completed = !engine->stopped.load(std::memory_order_relaxed);
+                    iteration.nodes = movesForeseen - iteration.nodes;
+                    iteration.tableProbes = tableStats.probes - iteration.tableProbes;
+                    iteration.tableHits = tableStats.hits - iteration.tableHits;
+                    iteration.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    iteration.pv.assign(pvTable.begin(), pvTable.begin() + pvLength[0]);
+
+                    if (!iteration.completed) break;
+
+                    depthReached = depth;
+
+                    if (id == 0 && engine->progress) {
+                        SearchProgress progress;
+                        progress.depth = depth;
+                        progress.score = iteration.score;
+                        // The shared count is behind by what this worker has not added yet.
+                        progress.nodes = engine->nodes.load(std::memory_order_relaxed) + movesForeseen % CHECKINTERVAL;
+                        progress.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - engine->startTime).count();
+                        progress.pv = iteration.pv;
+                        engine->progress(progress);
+                    }
+
+                    // The next iteration starts with this best line.
+                    prevPv.assign(pvTable.begin(), pvTable.begin() + pvLength[0]);
+
+                    // Every leaf was the end of the game, so deeper searches give the same result.
+                    if (!horizon) break;
                 }
-                // Assign
-                minMaxValue = *tempVal;
+            }
+        };
+
+        // Limits of every search, and when the current one started.
+        SearchLimits limits;
+        std::chrono::steady_clock::time_point startTime;
+
+        // Set when a limit is hit. Everything searched after that is thrown away.
+        std::atomic<bool> stopped;
+
+        // Nodes searched by every worker, updated every CHECKINTERVAL nodes.
+        std::atomic<long long> nodes;
+
+        // Number of threads searching every move.
+        int threads;
+
+        // Workers are kept between moves, so their buffers are only allocated once.
+        std::vector<std::unique_ptr<Worker>> workers;
+
+        // Searched positions, kept between moves and shared by every worker,
+        // and by other engines after setTable.
+        std::shared_ptr<TranspositionTable> table;
+
+        // Whether every search moves the age of the table on.
+        bool ageTable = true;
+
+        // Statistics of the last move.
+        SearchStats stats;
+
+        // Pattern weights, or null to count discs.
+        std::shared_ptr<const PatternEvaluator> evaluator;
+
+        // Whether the evaluator is used for the current move. Only when it fits the board size.
+        bool useEvaluator = false;
+
+        // The solver takes over at this many empties or less.
+        int endgameEmpties = 20;
+
+        // Whether the solver is used for the current move. It only plays 8x8 boards.
+        bool solving = false;
+
+        // Opening book, or null to always search.
+        std::shared_ptr<const OpeningBook> book;
+
+        // Multi-ProbCut parameters, or null to search every move fully.
+        std::shared_ptr<const ProbCut> probCut;
+
+        // Standard deviations a prediction must be outside the window by to cut.
+        double probCutThreshold = 1.5;
+
+        // Whether probCut is used for the current move. Only when it fits the board size.
+        bool useProbCut = false;
+
+        // Flag and progress of the searchMove running, or null and empty.
+        const std::atomic<bool>* cancel = nullptr;
+        std::function<void(const SearchProgress&)> progress;
+
+        // Set while the ponder search runs without limits, on the opponent's time.
+        std::atomic<bool> pondering;
+
+        // The ponder search, on a copy of the board with the predicted reply played.
+        // It is joinable until the next move or stopThinking.
+        std::thread ponderThread;
+        std::unique_ptr<Othello> ponderBoard;
+        uint64_t ponderHash = 0;
+
+        // Reply expected to the last move, from its best line. (-1, -1) if there is none.
+        Point expectedReply = Point(-1, -1);
+
+        // Gets the workers and the counters ready for a search of board, and starts the clock.
+        void prepare(Othello& board) {
+            while ((int)workers.size() < threads) workers.emplace_back(new Worker(this, workers.size()));
+            workers.resize(threads);
+            if (ageTable) table->newSearch();
 
-            } else {
-                // If there is no valid moves,
-                // Return min or max value.
-                minMaxValue = isMaxing ?
-                    std::numeric_limits<SCORE>::max():
-                    std::numeric_limits<SCORE>::min();
+            useEvaluator = evaluator && evaluator->size() == board.size;
+            solving = board.size == 8 && endgameEmpties > 0;
+            useProbCut = probCut && probCut->size() == board.size && probCutThreshold > 0;
+
+            startTime = std::chrono::steady_clock::now();
+            // A search cancelled before it started stops at once, with the first move.
+            stopped = cancel && cancel->load();
+            nodes = 0;
+        }
+
+        // Searches board with every worker until a limit is hit, or until it is stopped.
+        // The result is in the main worker.
+        void search(Othello& board) {
+            int maxDepth = limits.depth > 0 && limits.depth < MAXDEPTH ? limits.depth : MAXDEPTH;
+
+            // Every empty square takes at most a move and a pass, so deeper searches can't change.
+            int empties = board.size * board.size - board.getScore(white) - board.getScore(black);
+            if (maxDepth > empties * 2 + 1) maxDepth = empties * 2 + 1;
+
+            // Helpers search their own copy, until the main worker is done.
+            std::vector<std::unique_ptr<Othello>> copies;
+            std::vector<std::thread> helpers;
+            for (int i = 1; i < threads; i++) {
+                copies.emplace_back(new Othello(board));
+                helpers.emplace_back(&Worker::iterate, workers[i].get(), std::ref(*copies.back()), maxDepth);
             }
 
-            // Free the memory
-            delete[] vals;
+            workers[0]->iterate(board, maxDepth);
+
+            stopped = true;
+            for (size_t i = 0; i < helpers.size(); i++) helpers[i].join();
+        }
 
-            // Don't forget to undo the move when returning something.
-            board->undoMove();
+        // Puts the counters of every worker together, after a move is searched.
+        void collectStats(double milliseconds) {
+            Worker& main = *workers[0];
 
-            // Return
-            return minMaxValue;
+            stats.move = main.chosenSquare;
+            stats.fromBook = false;
+            stats.ponderHit = false;
+            stats.depthReached = main.depthReached;
+            stats.threads = threads;
+            stats.milliseconds = milliseconds;
+            stats.nodes = getMovesForeseen();
+            stats.table = getTableStats();
+            while ((int)stats.iterations.size() < main.iterationCount) {
+                stats.iterations.emplace_back();
+                stats.iterations.back().pv.reserve(MAXDEPTH + 1);
+            }
+            stats.iterations.resize(main.iterationCount);
+            for (int i = 0; i < main.iterationCount; i++) stats.iterations[i] = main.iterations[i];
+
+            // The score of the deepest completed iteration is the one the move comes from.
+            stats.score = 0;
+            expectedReply = Point(-1, -1);
+            for (int i = 0; i < main.iterationCount; i++) {
+                if (!main.iterations[i].completed) continue;
+                stats.score = main.iterations[i].score;
+                const std::vector<Point>& pv = main.iterations[i].pv;
+                if (pv.size() >= 2 && pv[0] == main.chosenSquare) expectedReply = pv[1];
+            }
+
+            stats.expandedNodes = 0;
+            stats.probCuts = 0;
+            for (int i = 0; i < SearchStats::CUTOFFSLOTS; i++) stats.cutoffs[i] = 0;
+            for (size_t w = 0; w < workers.size(); w++) {
+                stats.expandedNodes += workers[w]->expandedNodes;
+                stats.probCuts += workers[w]->probCuts;
+                for (int i = 0; i < SearchStats::CUTOFFSLOTS; i++) stats.cutoffs[i] += workers[w]->cutoffs[i];
+            }
         }
 
 public:
 
+        // Whether the search result is sent to the board's observer after every move.
+        bool verbose = true;
+
+        // Whether to search the expected reply while the opponent thinks. When the
+        // reply is played, that search goes on as the search of the next move.
+        bool ponder = false;
+
+        // If set, the statistics of every move are written to it as one line of JSON.
+        std::ostream* statsOutput = nullptr;
+
+        // hashMegabytes: memory used by the transposition table.
+        // By default, every move is searched for one second on one thread.
+        MinimaxEngine(size_t hashMegabytes = 16) : threads(1), table(std::make_shared<TranspositionTable>(hashMegabytes)), pondering(false) {
+            limits.moveTime = 1000;
+        }
+
+        ~MinimaxEngine() {
+            stopThinking();
+        }
+
+        // Sets the limits used by every following move.
+        void setLimits(const SearchLimits& limits) {
+            this->limits = limits;
+        }
+
+        const SearchLimits& getLimits() {
+            return limits;
+        }
+
+        // Scores leaves with pattern weights, which can be shared between engines.
+        // Null goes back to counting discs. Weights of another board size are not used.
+        void setEvaluator(std::shared_ptr<const PatternEvaluator> evaluator) {
+            this->evaluator = evaluator;
+        }
+
+        // Plays the moves of an opening book without searching, which can be shared
+        // between engines. Null always searches. A book of another board size is not used.
+        void setBook(std::shared_ptr<const OpeningBook> book) {
+            this->book = book;
+        }
+
+        // Prunes with Multi-ProbCut parameters from tools/fitprobcut, which can be shared
+        // between engines. Null searches every move fully. Parameters of another board
+        // size are not used. They must be fitted with the evaluator the engine uses.
+        void setProbCut(std::shared_ptr<const ProbCut> probCut) {
+            this->probCut = probCut;
+        }
+
+        // Sets how sure a cut must be, in standard deviations of the prediction (1.5).
+        // Lower cuts more and searches deeper, but makes more mistakes. 0 never cuts.
+        void setProbCutThreshold(double threshold) {
+            probCutThreshold = threshold < 0 ? 0 : threshold;
+        }
+
+        double getProbCutThreshold() {
+            return probCutThreshold;
+        }
+
+        // Sets the number of empties at which the exact solver takes over. 0 never solves.
+        void setEndgameEmpties(int empties) {
+            endgameEmpties = empties < 0 ? 0 : empties;
+        }
+
+        int getEndgameEmpties() {
+            return endgameEmpties;
+        }
+
+        // Sets how many threads search every move.
+        void setThreads(int threads) {
+            this->threads = threads < 1 ? 1 : threads;
+        }
+
+        int getThreads() {
+            return threads;
+        }
+
+        // The transposition table, to resize or clear it.
+        TranspositionTable& getTable() {
+            return *table;
+        }
+
+        // Searches with a table shared with other engines, which may search other games
+        // at the same time. They must use the same evaluator. Not while searching.
+        // With ageTable false, the searches don't move the age of the table on, and
+        // its owner does, like GameHost once per round of moves. Otherwise many
+        // engines wrap the age around so often that no entry looks old.
+        void setTable(std::shared_ptr<TranspositionTable> table, bool ageTable = true) {
+            stopThinking();
+            this->table = table;
+            this->ageTable = ageTable;
+        }
+
+        // Forgets every searched position, so the next search doesn't depend on the
+        // ones before. Must not be called while pondering, or while an engine that
+        // shares the table searches.
+        void clear() {
+            table->clear();
+            for (size_t i = 0; i < workers.size(); i++) {
+                if (workers[i]->solver) workers[i]->solver->clear();
+            }
+        }
+
+        // Table counters of the last move, summed over every worker.
+        TranspositionTable::Stats getTableStats() {
+            TranspositionTable::Stats stats;
+            for (size_t i = 0; i < workers.size(); i++) stats += workers[i]->tableStats;
+            return stats;
+        }
+
+        // Nodes searched for the last move, by every worker.
+        long long getMovesForeseen() {
+            long long total = 0;
+            for (size_t i = 0; i < workers.size(); i++) total += workers[i]->movesForeseen;
+            return total;
+        }
+
+        // Everything known about the search of the last move.
+        const SearchStats& getStats() {
+            return stats;
+        }
+
+        // Depth fully searched by the main worker for the last move.
+        int getDepthReached() {
+            return workers.empty() ? 0 : workers[0]->depthReached;
+        }
+
+        // Starts the ponder search, with the expected reply played on a copy of board.
+        // Without an expected reply, the best move in the table is taken.
+        void opponentThinking(Othello& board) {
+            stopThinking();
+            if (!ponder) return;
+
+            const MoveList& moves = board.getMoves(board.turn);
+            Point reply = expectedReply;
+            if (!moves.contains(reply)) {
+                TranspositionTable::Entry entry;
+                TranspositionTable::Stats unused;
+                if (!table->probe(board.getHash(), entry, unused) || !moves.contains(entry.move)) return;
+                reply = entry.move;
+            }
+
+            ponderBoard.reset(new Othello(board));
+            ponderBoard->playPiece(ponderBoard->turn, reply.x, reply.y, false);
+            ponderBoard->switchTurn();
+
+            // Nothing to think about if we would pass, or play from the book.
+            Point bookMove;
+            int bookScore;
+            if (ponderBoard->getMoves(ponderBoard->turn).empty()) return;
+            if (book && book->probe(*ponderBoard, bookMove, bookScore)) return;
+
+            ponderHash = ponderBoard->getHash();
+            prepare(*ponderBoard);
+            pondering = true;
+            ponderThread = std::thread(&MinimaxEngine::search, this, std::ref(*ponderBoard));
+        }
+
+        // nextMove with the limits, cancel flag and progress of request. The limits of the
+        // engine are left as they were. Stops thinking on the opponent's time first.
+        SearchResult searchMove(Othello& board, const SearchRequest& request) {
+            stopThinking();
+
+            SearchLimits kept = limits;
+            limits = request.limits;
+            cancel = request.cancel;
+            progress = request.progress;
+
+            SearchResult result;
+            result.move = nextMove(board);
+            result.score = stats.score;
+            result.depth = stats.depthReached;
+            result.nodes = stats.nodes;
+            result.milliseconds = stats.milliseconds;
+            result.cancelled = cancel && cancel->load();
+
+            limits = kept;
+            cancel = nullptr;
+            progress = nullptr;
+            return result;
+        }
+
+        // Stops the ponder search if there is one. Its results stay in the table.
+        void stopThinking() {
+            if (!ponderThread.joinable()) return;
+            stopped = true;
+            ponderThread.join();
+            pondering = false;
+        }
+
         Point nextMove(Othello& board) {
-            
-            // Init
-            movesForeseen = 0;
 
-            // Set board reference
-            this->board = &board;
+            bool ponderHit = false;
+            auto asked = std::chrono::steady_clock::now();
+            if (ponderThread.joinable()) {
+                if (board.getHash() == ponderHash) {
+                    // The expected reply was played, so the ponder search is the search
+                    // of this move, and the limits apply to it from now on.
+                    pondering.store(false, std::memory_order_release);
+                    ponderThread.join();
+                    ponderHit = true;
+                } else {
+                    stopThinking();
+                }
+            }
 
-            // Set wincolor
-            winColor = board.turn;
+            if (!ponderHit) {
+                prepare(board);
 
-            // Switch turns, because in the function it will get switched again
-            // To the original one
-            board.switchTurn();
+                Point bookMove;
+                int bookScore;
+                if (book && book->probe(board, bookMove, bookScore)) {
+                    for (size_t i = 0; i < workers.size(); i++) workers[i]->resetCounters();
+                    workers[0]->chosenSquare = bookMove;
 
-            // Measure time
-            auto start = std::chrono::high_resolution_clock::now();
+                    collectStats(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+                    stats.fromBook = true;
+                    stats.score = useEvaluator ? bookScore * PatternEvaluator::SCALE / OpeningBook::SCALE : bookScore / OpeningBook::SCALE;
 
-            // Gets the coordinate
-            minimaxRecur(0, true);
+                    if (verbose) board.getObserver().message("[MINIMAX ENGINE] Book move, score: " + std::to_string(stats.score));
+                    if (statsOutput) *statsOutput << stats.toJson() << '\n';
+
+                    return bookMove;
+                }
+
+                search(board);
+            }
 
             // End time
-            auto end = std::chrono::high_resolution_clock::now();
+            auto end = std::chrono::steady_clock::now();
+            collectStats(std::chrono::duration<double, std::milli>(end - startTime).count());
+            stats.ponderHit = ponderHit;
+
+            if (verbose) {
+                if (ponderHit) board.getObserver().message("[MINIMAX ENGINE] Ponder hit, waited " +
+                    std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(end - asked).count()) + "ms");
+                board.getObserver().message("[MINIMAX ENGINE] Depth: " + std::to_string(stats.depthReached) +
+                    ", number of moves foreseen: " + std::to_string(stats.nodes) + " (Took: " +
+                    std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(end-startTime).count()) + "ms)");
+                board.getObserver().message("[MINIMAX ENGINE] Table hits: " + std::to_string(stats.table.hits) + "/" +
+                    std::to_string(stats.table.probes) + " (Collisions: " + std::to_string(stats.table.collisions) + ")");
+            }
+
+            if (statsOutput) *statsOutput << stats.toJson() << '\n';
 
-            std::cout << "[MINIMAX ENGINE] Number of moves foreseen: " << movesForeseen << " (Took: " << 
-            std::chrono::duration_cast<std::chrono::milliseconds>(end-start).count() << "ms)" << std::endl;
-            
-            return chosenSquare;
+            return workers[0]->chosenSquare;
         }
     };
-}
\ No newline at end of file
+}
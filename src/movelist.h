@@ -0,0 +1,68 @@
+#pragma once
+
+#include "othutil.h"
+
+namespace oth {
+    /*
+        Fixed capacity list of moves, stored inline so it never allocates.
+        Holds every move of boards up to 32x32.
+    */
+    class MoveList {
+
+public:
+
+        const static int CAPACITY = 1024;
+
+        MoveList() : count(0) {}
+
+        // Adds a move to the end. The list must not be full.
+        void push(const Point& move) {
+            moves[count++] = move;
+        }
+
+        // Removes the move at index i, by moving the last move to its place.
+        void remove(int i) {
+            moves[i] = moves[--count];
+        }
+
+        void clear() {
+            count = 0;
+        }
+
+        int size() const {
+            return count;
+        }
+
+        bool empty() const {
+            return count == 0;
+        }
+
+        bool contains(const Point& move) const {
+            for (int i = 0; i < count; i++) {
+                if (moves[i] == move) return true;
+            }
+            return false;
+        }
+
+        const Point& operator[](int i) const {
+            return moves[i];
+        }
+
+        const Point& front() const {
+            return moves[0];
+        }
+
+        const Point* begin() const {
+            return moves;
+        }
+
+        const Point* end() const {
+            return moves + count;
+        }
+
+private:
+
+        Point moves[CAPACITY];
+        int count;
+    };
+}
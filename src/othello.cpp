@@ -1,46 +1,164 @@
 #include "othello.h"
 #include "othutil.h"
-#include <iostream>
-#include <list>
-#include <limits>
+#include <stdexcept>
+#include <cstring>
 
-#define RESET "\033[0m"
-#define BLACK "\033[37;40m"
-#define WHITE "\033[30;47m"
-#define EMPTY "\033[34;46m"
+using namespace oth;
 
-#define ANSICOLOR
+namespace {
+    // Zobrist key table, filled once before main.
+    struct ZobristTable {
+        uint64_t pieces[zobrist::MAXSIZE * zobrist::MAXSIZE][2];
+        uint64_t whiteTurn;
+
+        ZobristTable() {
+            // Splitmix64, with a fixed seed so the hashes are the same every run.
+            uint64_t seed = 0x4f7468656c6c6f21ULL;
+            for (int i = 0; i < zobrist::MAXSIZE * zobrist::MAXSIZE; i++) {
+                pieces[i][0] = next(seed);
+                pieces[i][1] = next(seed);
+            }
+            whiteTurn = next(seed);
+        }
 
-using namespace oth;
+        static uint64_t next(uint64_t& seed) {
+            uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+    };
+
+    const ZobristTable zobristTable;
+
+    // Observer of boards that are not shown.
+    NullObserver nullObserver;
+}
+
+uint64_t zobrist::piece(Color color, int x, int y) {
+    if (color == none) return 0;
+    int sq = (y % MAXSIZE) * MAXSIZE + (x % MAXSIZE);
+    return zobristTable.pieces[sq][color - 1];
+}
+
+uint64_t zobrist::whiteTurn() {
+    return zobristTable.whiteTurn;
+}
+
+const patterns::Layout& patterns::layout(int size) {
+    // Every size is built at the first call.
+    static const std::vector<Layout> layouts = []() {
+        std::vector<Layout> all(Othello::MAXSIZE + 1);
+
+        for (int size = 4; size <= Othello::MAXSIZE; size++) {
+            Layout& layout = all[size];
+            int last = size - 1;
+
+            // Every corner, with the directions that go into the board.
+            const int corners[4][4] = {
+                { 0, 0, 1, 1 }, { last, 0, -1, 1 }, { 0, last, 1, -1 }, { last, last, -1, -1 }
+            };
+
+            for (int c = 0; c < 4; c++) {
+                int ox = corners[c][0], oy = corners[c][1], dx = corners[c][2], dy = corners[c][3];
+
+                for (int i = 0; i < 9; i++) layout.cells[c].push_back(Point(ox + dx * (i % 3), oy + dy * (i / 3)));
+
+                for (int i = 0; i < cells(EDGE, size); i++) {
+                    layout.cells[4 + c * 2].push_back(Point(ox + dx * i, oy));
+                    layout.cells[5 + c * 2].push_back(Point(ox, oy + dy * i));
+                }
+
+                for (int i = 0; i < cells(DIAGONAL, size); i++) layout.cells[12 + c].push_back(Point(ox + dx * i, oy + dy * i));
+            }
+
+            // Turn the lists of cells into links from every cell.
+            std::vector<std::vector<Layout::Link>> byCell(size * size);
+            for (int n = 0; n < INSTANCES; n++) {
+                for (size_t i = 0; i < layout.cells[n].size(); i++) {
+                    Layout::Link link;
+                    link.instance = n;
+                    link.power = pow3[i];
+                    byCell[layout.cells[n][i].y * size + layout.cells[n][i].x].push_back(link);
+                }
+            }
+
+            for (int cell = 0; cell < size * size; cell++) {
+                layout.start.push_back(layout.links.size());
+                layout.links.insert(layout.links.end(), byCell[cell].begin(), byCell[cell].end());
+            }
+            layout.start.push_back(layout.links.size());
+        }
+
+        return all;
+    }();
+
+    return layouts[size];
+}
 
 Othello::Cell::Cell() {
     this->col = none;
+    this->checked = false;
+    this->adjacent = 0;
+    this->whiteIndex = -1;
+    this->blackIndex = -1;
 }
 
-Othello::UndoData::UndoData(Color col, Point coor) : col(col), coor(coor) {}
-
 Point::Point() : x(0), y(0) {}
 Point::Point(int x, int y) : x(x), y(y) {}
 
+bool Point::operator==(const Point& other) const { return x == other.x && y == other.y; }
+bool Point::operator!=(const Point& other) const { return !(*this == other); }
+
 Othello::Othello(int size, Engine& whiteEngine, Engine& blackEngine) :
     size(size),
     whiteEngine(&whiteEngine),
-    blackEngine(&blackEngine)
+    blackEngine(&blackEngine),
+    observer(&nullObserver)
     {
 
+    if (size < 4 || size > MAXSIZE) throw std::invalid_argument("Board size must be between 4 and 32");
+
     whiteScore = 0;
     blackScore = 0;
+    turn = black;
+
+#ifdef OTH_NO_BITBOARD
+    bitboard = false;
+    wide = false;
+#else
+    bitboard = size == 8;
+    wide = size > 8 && size <= wb::STRIDE;
+#endif
+
+    discs[none] = discs[black] = discs[white] = 0;
+    hash = 0;
+
+    std::memset(wideDiscs, 0, sizeof(wideDiscs));
+    std::memset(wideBoard, 0, sizeof(wideBoard));
+    if (wide) {
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) wb::set(wideBoard, wb::square(x, y));
+        }
+    }
+
+    // Every pattern of an empty board is 0.
+    layout = &patterns::layout(size);
+    for (int i = 0; i < patterns::INSTANCES; i++) patternIndex[i] = 0;
 
-    // Create the first dimension
-    this->board = new Cell*[size];
-    this->_checked = new bool*[size];
+    // The cell matrix is only needed when the bitboards can't be used.
+    if (!bitboard && !wide) {
+        // One allocation for every cell
+        board.resize(size * size);
 
-    // Create the second dimension
-    for (int i = 0; i < size; i++) {
-        this->board[i] = new Cell[size];
-        this->_checked[i] = new bool[size];
+        activePieces.reserve(size * size);
+        activeIndex.assign(size * size, -1);
+        candidates.reserve(size * size);
     }
 
+    reserveUndo();
+    pickRoutines();
+
     // Fill the middle of the board with the initial pieces.
     int half = size/2;
 
@@ -54,28 +172,62 @@ Othello::Othello(int size, Engine& whiteEngine, Engine& blackEngine) :
     updateValidMoves();
 }
 
-Othello::~Othello() {
-    // Deallocate everything
-    // First, deallocate the extra dimension
-    for (int i = 0; i < size; i++) {
-        delete[] this->board[i];
-        delete[] this->_checked[i];
-    }
+Othello::Othello(const Othello& other) :
+    whiteScore(other.whiteScore),
+    blackScore(other.blackScore),
+    whiteEngine(other.whiteEngine),
+    blackEngine(other.blackEngine),
+    observer(other.observer),
+    board(other.board),
+    activePieces(other.activePieces),
+    activeIndex(other.activeIndex),
+    undoCells(other.undoCells),
+    bitboard(other.bitboard),
+    wide(other.wide),
+    hash(other.hash),
+    layout(other.layout),
+    whiteMove(other.whiteMove),
+    blackMove(other.blackMove),
+    size(other.size),
+    turn(other.turn),
+    undos(other.undos)
+    {
+
+    discs[none] = other.discs[none];
+    discs[black] = other.discs[black];
+    discs[white] = other.discs[white];
 
-    delete[] this->board;
-    delete[] this->_checked;
+    std::memcpy(wideDiscs, other.wideDiscs, sizeof(wideDiscs));
+    std::memcpy(wideBoard, other.wideBoard, sizeof(wideBoard));
+
+    for (int i = 0; i < patterns::INSTANCES; i++) patternIndex[i] = other.patternIndex[i];
+
+    // Copies only get the space they use, so reserve again.
+    activePieces.reserve(size * size);
+    candidates.reserve(size * size);
+    reserveUndo();
+    pickRoutines();
 }
 
+void Othello::reserveUndo() {
+    // Every move fills a cell, and flips at most size - 2 cells to every direction.
+    undos.reserve(size * size);
+    if (!bitboard) undoCells.reserve(size * size * 8 * (size > 2 ? size - 2 : 1));
+}
 
 void Othello::_resetChecked() {
-    for (int i = 0; i < size; i++) {
-        for (int j = 0; j < size; j++) {
-            _checked[i][j] = false;
-        }
+    for (int i = 0; i < size * size; i++) {
+        board[i].checked = false;
     }
 }
 
 void Othello::_resetPotentialMoves() {
+    if (!bitboard && !wide) {
+        // Forget where the moves were in the lists.
+        for (int i = 0; i < whiteMove.size(); i++) cell(whiteMove[i].x, whiteMove[i].y).whiteIndex = -1;
+        for (int i = 0; i < blackMove.size(); i++) cell(blackMove[i].x, blackMove[i].y).blackIndex = -1;
+    }
+
     whiteMove.clear();
     blackMove.clear();
 }
@@ -84,9 +236,15 @@ bool Othello::updatePiece(Color color, int x, int y) {
     // Check if within bounds
     if (!(x > -1 && y > -1 && x < size && y < size)) return false;
 
+    Color prev = at(x, y);
+
+    // Swap the piece in the hash and the patterns.
+    hash ^= zobrist::piece(prev, x, y) ^ zobrist::piece(color, x, y);
+    updatePatterns(x, y, prev, color);
+
     // Check what's in the board at that point
     // And update the score.
-    switch (board[y][x].col) {
+    switch (prev) {
         case (white):
             whiteScore--;
             break;
@@ -105,45 +263,212 @@ bool Othello::updatePiece(Color color, int x, int y) {
             break;
     }
 
+    if (bitboard) {
+        // Clear the square, then set the bit of the new color.
+        uint64_t sq = bb::bit(x, y);
+        discs[black] &= ~sq;
+        discs[white] &= ~sq;
+        if (color != none) discs[color] |= sq;
+        return true;
+    }
+
+    if (wide) {
+        int sq = wb::square(x, y);
+        wb::clear(wideDiscs[black], sq);
+        wb::clear(wideDiscs[white], sq);
+        if (color != none) wb::set(wideDiscs[color], sq);
+        return true;
+    }
+
     // Adds the corresponding piece to the board.
-    board[y][x].col = color;
+    cell(x, y).col = color;
 
-    // Removes the active piece, if one overwrites it.
-    activePieces.remove_if([x, y](const Point& point) { return (point.x == x && point.y == y); });
+    // Count the piece in the neighbours, when a cell gets filled or emptied.
+    if ((prev == none) != (color == none)) {
+        int change = color == none ? -1 : 1;
+        for (int i = 0; i < 8; i++) {
+            int cy = y + direction[i][0];
+            int cx = x + direction[i][1];
+            if (cx < size && cx > -1 && cy < size && cy > -1) cell(cx, cy).adjacent += change;
+        }
+    }
 
-    // Adds the coordinate to the active pieces list.
-    if (color != none)
+    int cell = y * size + x;
+    if (prev != none && color == none) {
+        // Removes the active piece, by moving the last one to its place.
+        Point last = activePieces.back();
+        activePieces[activeIndex[cell]] = last;
+        activeIndex[last.y * size + last.x] = activeIndex[cell];
+        activePieces.pop_back();
+        activeIndex[cell] = -1;
+    } else if (prev == none && color != none) {
+        // Adds the coordinate to the active pieces list.
+        activeIndex[cell] = activePieces.size();
         activePieces.push_back(Point(x, y));
+    }
 
     return true;
 }
 
 void Othello::playPiece(Color color, int x, int y, bool addUndoStack) {
 
-    // Allocate space for list
-    std::list<UndoData>* undoImd;
+    // Check if within bounds
+    if (!(x > -1 && y > -1 && x < size && y < size)) return;
+
+    // Remember what the move changes, so it can be undone.
+    UndoData undo;
+    undo.coor = Point(x, y);
+    undo.col = at(x, y);
+    undo.played = color;
+    undo.hash = hash;
+    for (int i = 0; i < patterns::INSTANCES; i++) undo.patterns[i] = patternIndex[i];
+    undo.flipped = 0;
+    undo.start = undoCells.size();
+
+    // Adds the piece
+    updatePiece(color, x, y);
+
+    if (bitboard && color != none) {
+        Color opp = color == white ? black : white;
+
+        // Computes every flipped disc at once.
+        uint64_t flipped = bb::flips(discs[color], discs[opp], bb::square(x, y));
+        undo.flipped = flipped;
+
+        // Flip colors, and move the score
+        for (uint64_t it = flipped; it;) {
+            int sq = bb::popLsb(it);
+            hash ^= zobrist::piece(white, sq & 7, sq >> 3) ^ zobrist::piece(black, sq & 7, sq >> 3);
+            updatePatterns(sq & 7, sq >> 3, opp, color);
+        }
+        discs[color] |= flipped;
+        discs[opp] &= ~flipped;
+
+        int count = bb::popCount(flipped);
+        if (color == white) {
+            whiteScore += count;
+            blackScore -= count;
+        } else {
+            blackScore += count;
+            whiteScore -= count;
+        }
+    } else if (!bitboard) {
+        (this->*flipRoutine)(color, x, y);
+    }
+
+    if (bitboard) {
+        if (addUndoStack) undos.push_back(undo);
+        updateValidMoves();
+        return;
+    }
+
+    // Only the lines through the changed cells can gain or lose moves.
+    undo.count = undoCells.size() - undo.start;
+    (this->*movesAroundRoutine)(undo.coor, undoCells.data() + undo.start, undo.count);
+
     if (addUndoStack) {
-        // Insert to top of stack, if true
-        undos.push(std::list<UndoData>());
-        // Define pointer
-        undoImd = &undos.top();
-        // Adds the current piece
-        undoImd->push_back(UndoData(board[y][x].col, Point(x, y)));
+        undos.push_back(undo);
+    } else {
+        undoCells.resize(undo.start);
     }
 
-    // Adds the piece
-    if (!updatePiece(color, x, y)) return;
+#ifdef OTH_CHECK_MOVES
+    checkMoves();
+#endif
+}
 
+void Othello::updatePatterns(int x, int y, Color from, Color to) {
+    // Colors are the digits, so the number moves by the difference.
+    int change = int(to) - int(from);
+    if (change == 0) return;
+
+    int cell = y * size + x;
+    for (int i = layout->start[cell]; i < layout->start[cell + 1]; i++) {
+        const patterns::Layout::Link& link = layout->links[i];
+        patternIndex[link.instance] += change * link.power;
+    }
+}
+
+void Othello::updateValidMoves() {
+    if (bitboard) {
+        // Generate the moves of both colors in parallel.
+        fillMoves(whiteMove, bb::moves(discs[white], discs[black]));
+        fillMoves(blackMove, bb::moves(discs[black], discs[white]));
+        return;
+    }
+
+    (this->*rebuildRoutine)();
+}
+
+void Othello::flipWide(Color color, int x, int y) {
+    if (color == none) return;
+    Color opp = color == white ? black : white;
+
+    wb::Bits own = wb::Bits::load(wideDiscs[color]);
+    wb::Bits other = wb::Bits::load(wideDiscs[opp]);
+    wb::Bits flipped = wb::flips(own, other, wb::square(x, y));
+    (own | flipped).store(wideDiscs[color]);
+    (other & ~flipped).store(wideDiscs[opp]);
+
+    int count = 0;
+    for (int w = 0; w < wb::WORDS; w++) {
+        for (uint64_t it = flipped.word(w); it;) {
+            int sq = w * 64 + bb::popLsb(it);
+            int cx = sq % wb::STRIDE;
+            int cy = sq / wb::STRIDE;
+            hash ^= zobrist::piece(white, cx, cy) ^ zobrist::piece(black, cx, cy);
+            updatePatterns(cx, cy, opp, color);
+
+            // The same list of flipped cells as the cell matrix, so undoMove is the same for both.
+            undoCells.push_back(Point(cx, cy));
+            count++;
+        }
+    }
+
+    if (color == white) {
+        whiteScore += count;
+        blackScore -= count;
+    } else {
+        blackScore += count;
+        whiteScore -= count;
+    }
+}
+
+void Othello::rebuildWide() {
+    wb::Bits blacks = wb::Bits::load(wideDiscs[black]);
+    wb::Bits whites = wb::Bits::load(wideDiscs[white]);
+    wb::Bits empty = wb::Bits::load(wideBoard) & ~(blacks | whites);
+
+    fillWideMoves(whiteMove, wb::moves(whites, blacks, empty));
+    fillWideMoves(blackMove, wb::moves(blacks, whites, empty));
+}
+
+void Othello::updateWideMoves(Point played, const Point* flipped, int count) {
+    rebuildWide();
+}
+
+void Othello::fillWideMoves(MoveList& list, const wb::Bits& mask) {
+    list.clear();
+    for (int w = 0; w < wb::WORDS; w++) {
+        for (uint64_t it = mask.word(w); it;) {
+            int sq = w * 64 + bb::popLsb(it);
+            list.push(Point(sq % wb::STRIDE, sq / wb::STRIDE));
+        }
+    }
+}
+
+template<int N>
+void Othello::flipCells(Color color, int x, int y) {
     // Walk the board, to see any takes.
     for (int i = 0; i < 8; i++) {
         // Walk the board to see any takes
-        Color edgeColor = walkBoard(x, y, direction[i]);
+        Color edgeColor = walkBoard<N>(x, y, direction[i]);
 
         // Choose next direction
         const int* dir = direction[i];
         int cy = y + dir[0];
         int cx = x + dir[1];
-        
+
         if (edgeColor != none && color == edgeColor) {
             do {
                 // Add and minus score
@@ -155,29 +480,32 @@ void Othello::playPiece(Color color, int x, int y, bool addUndoStack) {
                     whiteScore--;
                 }
 
-                // Add to undo list
-                if (addUndoStack) undoImd->push_back(UndoData(board[cy][cx].col, Point(cx, cy)));
+                // Add to undo list, which also tells what to recheck.
+                undoCells.push_back(Point(cx, cy));
 
                 // Flip color
-                board[cy][cx].col = color;
+                Cell& flipped = cellAt<N>(cx, cy);
+                hash ^= zobrist::piece(flipped.col, cx, cy) ^ zobrist::piece(color, cx, cy);
+                updatePatterns(cx, cy, flipped.col, color);
+                flipped.col = color;
 
                 // Add coordinates
                 cy += dir[0];
                 cx += dir[1];
-            } while (!(board[cy][cx].col == edgeColor));
+            } while (!(cellAt<N>(cx, cy).col == edgeColor));
         }
     }
-
-    updateValidMoves();
 }
 
-void Othello::updateValidMoves() {
+template<int N>
+void Othello::rebuildMoves() {
+    const int n = side<N>();
+
     // Reconstructs the possibilities.
-    _resetChecked();
     _resetPotentialMoves();
 
     // Iterates the present pieces
-    for (std::list<Point>::iterator it = activePieces.begin(); it != activePieces.end(); ++it) {
+    for (std::vector<Point>::iterator it = activePieces.begin(); it != activePieces.end(); ++it) {
         int x = it->x;
         int y = it->y;
 
@@ -190,58 +518,263 @@ void Othello::updateValidMoves() {
 
             // If this cell is not checked yet and not occupied, do stuff
             // Also check if the cell is still inside the boundary
-            if ((cx < size && cx > -1 && cy < size && cy > -1) && board[cy][cx].col == none && !_checked[cy][cx]) {
+            if ((cx < n && cx > -1 && cy < n && cy > -1) && cellAt<N>(cx, cy).col == none && !cellAt<N>(cx, cy).checked) {
 
                 // Tag as checked
-                _checked[cy][cx] = true;
+                cellAt<N>(cx, cy).checked = true;
 
                 // Check if the move is valid.
-                updatePotentialCell(cx, cy);
+                updatePotentialCell<N>(cx, cy);
             }
         }
     }
+
+    // Leave every cell unchecked, so updateMovesAround can use the flags too.
+    _resetChecked();
 }
 
+template<int N>
 void Othello::updatePotentialCell(int x, int y) {
+    bool whiteFound = false;
+    bool blackFound = false;
+
+    // Occupied cells are never moves, and neither are cells with no pieces around.
+    if (cellAt<N>(x, y).col != none || cellAt<N>(x, y).adjacent == 0) {
+        setMove<N>(white, x, y, false);
+        setMove<N>(black, x, y, false);
+        return;
+    }
+
     // Iterate all the directions adjacent to current tile.
-    for (int i = 0; i < 8; i++) {
-        switch (walkBoard(x, y, direction[i])) {
+    // Stop once the cell is a move for both colors, so it is only added once.
+    for (int i = 0; i < 8 && !(whiteFound && blackFound); i++) {
+        switch (walkBoard<N>(x, y, direction[i])) {
             case white:
-                whiteMove.push_back(Point(x, y));
+                whiteFound = true;
                 break;
             case black:
-                blackMove.push_back(Point(x, y));
+                blackFound = true;
                 break;
         }
     }
+
+    setMove<N>(white, x, y, whiteFound);
+    setMove<N>(black, x, y, blackFound);
+}
+
+template<int N>
+void Othello::setMove(Color color, int x, int y, bool valid) {
+    MoveList& list = color == white ? whiteMove : blackMove;
+    short& index = color == white ? cellAt<N>(x, y).whiteIndex : cellAt<N>(x, y).blackIndex;
+
+    if (valid && index < 0) {
+        index = list.size();
+        list.push(Point(x, y));
+    } else if (!valid && index >= 0) {
+        // The last move takes its place, so fix the index of that one.
+        list.remove(index);
+        if (index < list.size()) {
+            Point moved = list[index];
+            if (color == white) cellAt<N>(moved.x, moved.y).whiteIndex = index;
+            else cellAt<N>(moved.x, moved.y).blackIndex = index;
+        }
+        index = -1;
+    }
 }
 
+template<int N>
+void Othello::updateMovesAround(Point played, const Point* flipped, int count) {
+    const int n = side<N>();
+    candidates.clear();
+
+    // A cell is a move only through the lines it starts. So walk back from every
+    // changed cell over the pieces, and the first empty cell is one to recheck.
+    for (int c = -1; c < count; c++) {
+        Point changed = c < 0 ? played : flipped[c];
+
+        if (!cellAt<N>(changed.x, changed.y).checked) {
+            cellAt<N>(changed.x, changed.y).checked = true;
+            candidates.push_back(changed);
+        }
+
+        for (int i = 0; i < 8; i++) {
+            int cy = changed.y + direction[i][0];
+            int cx = changed.x + direction[i][1];
+
+            while (cx < n && cx > -1 && cy < n && cy > -1 && cellAt<N>(cx, cy).col != none) {
+                cy += direction[i][0];
+                cx += direction[i][1];
+            }
+
+            if (cx < n && cx > -1 && cy < n && cy > -1 && !cellAt<N>(cx, cy).checked) {
+                cellAt<N>(cx, cy).checked = true;
+                candidates.push_back(Point(cx, cy));
+            }
+        }
+    }
+
+    for (std::vector<Point>::iterator it = candidates.begin(); it != candidates.end(); ++it) {
+        cellAt<N>(it->x, it->y).checked = false;
+        updatePotentialCell<N>(it->x, it->y);
+    }
+}
+
+template<int N>
 Color Othello::walkBoard(int x, int y, const int* direction) {
+    const int n = side<N>();
     y += direction[0];
     x += direction[1];
 
     // If out of bounds or no color, continue.
-    if (!(x < this->size && x > -1 && y < this->size && y > -1)) return none;
-    if (board[y][x].col == none) return none;
+    if (!(x < n && x > -1 && y < n && y > -1)) return none;
+    if (cellAt<N>(x, y).col == none) return none;
 
     // Eat color is the color of piece that will be consumed if the move is valid
-    Color eatColor = board[y][x].col;
+    Color eatColor = cellAt<N>(x, y).col;
 
     // Walk the board, if the tile is not none, and still within the bounds.
     do {
         // Return the color, if different color is found.
-        if (board[y][x].col != eatColor) {
-            return board[y][x].col;
+        if (cellAt<N>(x, y).col != eatColor) {
+            return cellAt<N>(x, y).col;
         }
 
         // Walk
         y += direction[0];
-        x += direction[1];        
+        x += direction[1];
 
-    } while (x < this->size && x > -1 && y < this->size && y > -1);
+    } while (x < n && x > -1 && y < n && y > -1);
     return none;
 }
 
+void Othello::pickRoutines() {
+    if (wide) {
+        flipRoutine = &Othello::flipWide;
+        rebuildRoutine = &Othello::rebuildWide;
+        movesAroundRoutine = &Othello::updateWideMoves;
+        walkRoutine = nullptr;
+        return;
+    }
+
+    switch (size) {
+        case 6:
+            flipRoutine = &Othello::flipCells<6>;
+            rebuildRoutine = &Othello::rebuildMoves<6>;
+            movesAroundRoutine = &Othello::updateMovesAround<6>;
+            walkRoutine = &Othello::walkBoard<6>;
+            break;
+        case 8:
+            flipRoutine = &Othello::flipCells<8>;
+            rebuildRoutine = &Othello::rebuildMoves<8>;
+            movesAroundRoutine = &Othello::updateMovesAround<8>;
+            walkRoutine = &Othello::walkBoard<8>;
+            break;
+        case 10:
+            flipRoutine = &Othello::flipCells<10>;
+            rebuildRoutine = &Othello::rebuildMoves<10>;
+            movesAroundRoutine = &Othello::updateMovesAround<10>;
+            walkRoutine = &Othello::walkBoard<10>;
+            break;
+        default:
+            flipRoutine = &Othello::flipCells<0>;
+            rebuildRoutine = &Othello::rebuildMoves<0>;
+            movesAroundRoutine = &Othello::updateMovesAround<0>;
+            walkRoutine = &Othello::walkBoard<0>;
+    }
+}
+
+bool Othello::movesConsistent() {
+    if (bitboard || wide) return true;
+
+    int whiteCount = 0;
+    int blackCount = 0;
+
+    // Checks every empty cell on its own, without the move lists or the frontier.
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            bool whiteFound = false;
+            bool blackFound = false;
+
+            if (cell(x, y).col == none) {
+                for (int i = 0; i < 8; i++) {
+                    switch ((this->*walkRoutine)(x, y, direction[i])) {
+                        case white:
+                            whiteFound = true;
+                            break;
+                        case black:
+                            blackFound = true;
+                            break;
+                        default:
+                            break;
+                    }
+                }
+            }
+
+            short whiteIndex = cell(x, y).whiteIndex;
+            short blackIndex = cell(x, y).blackIndex;
+
+            if (whiteFound != (whiteIndex >= 0) || blackFound != (blackIndex >= 0)) return false;
+            if (whiteFound && (whiteIndex >= whiteMove.size() || whiteMove[whiteIndex] != Point(x, y))) return false;
+            if (blackFound && (blackIndex >= blackMove.size() || blackMove[blackIndex] != Point(x, y))) return false;
+
+            whiteCount += whiteFound;
+            blackCount += blackFound;
+        }
+    }
+
+    return whiteCount == whiteMove.size() && blackCount == blackMove.size();
+}
+
+void Othello::checkMoves() {
+    if (!movesConsistent()) throw std::logic_error("Incremental move lists differ from a full rebuild");
+}
+
+void Othello::fillMoves(MoveList& list, uint64_t mask) {
+    list.clear();
+    while (mask) {
+        int sq = bb::popLsb(mask);
+        list.push(Point(sq & 7, sq >> 3));
+    }
+}
+
+Color Othello::at(int x, int y) {
+    if (bitboard) {
+        uint64_t sq = bb::bit(x, y);
+        if (discs[black] & sq) return black;
+        if (discs[white] & sq) return white;
+        return none;
+    }
+
+    if (wide) {
+        int sq = wb::square(x, y);
+        if (wb::test(wideDiscs[black], sq)) return black;
+        if (wb::test(wideDiscs[white], sq)) return white;
+        return none;
+    }
+
+    return cell(x, y).col;
+}
+
+const MoveList& Othello::getMoves(Color color) {
+    return color == white ? whiteMove : blackMove;
+}
+
+uint64_t Othello::getHash() {
+    return turn == white ? hash ^ zobrist::whiteTurn() : hash;
+}
+
+uint64_t Othello::getDiscs(Color color) {
+    if (bitboard) return discs[color];
+
+    uint64_t result = 0;
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            if (at(x, y) == color) result |= bb::bit(x, y);
+        }
+    }
+    return result;
+}
+
 int Othello::getScore(Color color) {
     switch(color) {
         case (white):
@@ -267,60 +800,99 @@ Color Othello::switchTurn() {
     return turn;
 }
 
+void Othello::setPosition(const std::string& cells, Color turn) {
+    if ((int)cells.size() != size * size) throw std::invalid_argument("Position must have one character per cell");
+
+    // Read everything first, so a bad position leaves the board as it was.
+    std::vector<Color> colors(size * size);
+    for (int i = 0; i < size * size; i++) {
+        switch (cells[i]) {
+            case 'X': case 'x': case '*':
+                colors[i] = black;
+                break;
+            case 'O': case 'o':
+                colors[i] = white;
+                break;
+            case '-': case '.':
+                colors[i] = none;
+                break;
+            default:
+                throw std::invalid_argument(std::string("Unknown cell character: ") + cells[i]);
+        }
+    }
+
+    // Empty the board first, so the pieces and the moves are listed in the same
+    // order whatever was on the board before.
+    for (int i = 0; i < size * size; i++) updatePiece(none, i % size, i / size);
+    for (int i = 0; i < size * size; i++) updatePiece(colors[i], i % size, i / size);
+
+    undos.clear();
+    undoCells.clear();
+    this->turn = turn;
+    updateValidMoves();
+}
+
 void Othello::undoMove() {
     // Undoes one move
 
     if (undos.empty()) return;
 
     // Get the top
-    std::list<UndoData>* undo = &undos.top();
+    const UndoData& undo = undos.back();
+    int x = undo.coor.x;
+    int y = undo.coor.y;
+    Color opp = undo.played == white ? black : white;
+
+    if (bitboard) {
+        // Put back the cell, and flip the discs back.
+        uint64_t sq = bb::bit(x, y);
+        discs[black] &= ~sq;
+        discs[white] &= ~sq;
+        if (undo.col != none) discs[undo.col] |= sq;
+
+        if (undo.played != none) {
+            discs[undo.played] &= ~undo.flipped;
+            discs[opp] |= undo.flipped;
+        }
 
-    // Do all the moves here.
-    for (std::list<UndoData>::iterator it = undo->begin(); it != undo->end(); ++it) {
-        // Data pointer
-        UndoData* uData = &(*it);
-        updatePiece(uData->col, uData->coor.x, uData->coor.y);
+        whiteScore = bb::popCount(discs[white]);
+        blackScore = bb::popCount(discs[black]);
+        hash = undo.hash;
+        for (int i = 0; i < patterns::INSTANCES; i++) patternIndex[i] = undo.patterns[i];
+
+        // The moves of the restored board
+        updateValidMoves();
+    } else {
+        // Flipped cells always belonged to the opponent.
+        for (int i = undo.start; i < undo.start + undo.count; i++) {
+            updatePiece(opp, undoCells[i].x, undoCells[i].y);
+        }
+        updatePiece(undo.col, x, y);
+
+        // The same cells changed back, so the same lines are rechecked.
+        (this->*movesAroundRoutine)(undo.coor, undoCells.data() + undo.start, undo.count);
+
+        // Shrinking keeps the reserved space.
+        undoCells.resize(undo.start);
     }
 
     // Pop stack
-    undos.pop();
+    undos.pop_back();
+
+#ifdef OTH_CHECK_MOVES
+    checkMoves();
+#endif
 
     // Switch the turn
     switchTurn();
 }
 
-void Othello::drawBoard() {
-
-    // Print first row of number coords
-    std::cout << "  ";
-    for (int i = 0; i < size;) std::cout << (++i) % 10 << " ";
-    std::cout << std::endl;
-
-    // Iterate the board matrix
-    for (int i = 0; i < size; i++) {
-        // Print column number coords
-        std::cout << (i+1) % 10 << " ";
-
-        for (int j = 0; j < size; j++) {
-
-            // Print corresponding symbol
-            char symbol;
+void Othello::setObserver(GameObserver& observer) {
+    this->observer = &observer;
+}
 
-            // Print the piece, if the cell is occupied.
-            switch(board[i][j].col) {
-                case(black):
-                    std::cout << BLACK << "[]" << RESET;
-                    break;
-                case(white):
-                    std::cout << WHITE << "[]" << RESET;
-                    break;
-                default:
-                    std::cout << EMPTY << "  " << RESET;
-            }
-        }
-        std::cout << std::endl;
-    }
-    std::cout << "White: " << whiteScore << " | Black: " << blackScore << std::endl;
+GameObserver& Othello::getObserver() {
+    return *observer;
 }
 
 void Othello::startGame(Color startTurn) {
@@ -329,42 +901,44 @@ void Othello::startGame(Color startTurn) {
     // Start with turn
     turn = startTurn;
 
-    std::cout << "Initial board:" << std::endl;
-    drawBoard();
+    observer->gameStarted(*this);
 
-    // While there is still valid moves, we loop.
-    while ((turn == black && blackMove.size() > 0) || (turn == white && whiteMove.size() > 0)) {
+    // Loop until both colors have to pass.
+    bool passed = false;
+    while (true) {
+        if (getMoves(turn).empty()) {
+            if (passed) break;
+            passed = true;
 
-        if (pauseEveryTurn) {
-            std::cout << "Press Enter to Continue\n";
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(),'\n');
+            observer->passed(*this, turn);
+            switchTurn();
+            continue;
         }
+        passed = false;
 
-        std::cout << (turn == white ? "White" : "Black") << "'s Turn" << std::endl;
+        observer->turnStarted(*this);
 
         // Assign the correct engine
-        Engine* curEngine;
-        switch (turn) {
-            case(black):
-                curEngine = blackEngine;
-                break;
-            case(white):
-                curEngine = whiteEngine;
-                break;
-        }
+        Engine* curEngine = turn == white ? whiteEngine : blackEngine;
+        Engine* otherEngine = turn == white ? blackEngine : whiteEngine;
+
+        // The other engine can think while this one does.
+        if (otherEngine != curEngine) otherEngine->opponentThinking(*this);
 
         // Run the engine
         Point move = curEngine->nextMove(*this);
+        if (!getMoves(turn).contains(move)) throw std::logic_error("Engine returned an illegal move");
 
         // And insert the move.
-        std::cout << (turn == white ? "White" : "Black") << " Plays (" << move.x+1 << ", " << move.y+1 << ")" << std::endl;
         playPiece(turn, move.x, move.y, false);
+        observer->movePlayed(*this, turn, move);
 
-        drawBoard();
-        
         // Switch the turns
         switchTurn();
     }
 
-    std::cout << "Game over" << std::endl;
-}
\ No newline at end of file
+    whiteEngine->stopThinking();
+    blackEngine->stopThinking();
+
+    observer->gameOver(*this);
+}
@@ -1,9 +1,16 @@
 #pragma once
 
-#include <list>
-#include <stack>
+#include <vector>
+#include <string>
+#include <cstdint>
 #include "othutil.h"
+#include "movelist.h"
+#include "bitboard.h"
+#include "widebitboard.h"
+#include "zobrist.h"
+#include "patterns.h"
 #include "othengine.h"
+#include "othobserver.h"
 
 namespace oth {
     // 8 Directions to iterate, when checking adjacent cells
@@ -23,21 +30,50 @@ private:
 
     friend class Engine;
 
+    // tools/boardbench times the private routines on their own.
+    friend struct BoardBench;
+
     // Describes what color a cell is occupying.
     // It also describes possible moves.
     struct Cell {
         // The piece color that occupies this cell.
         Color col;
 
+        // Helper variable to keep track whether a cell is checked for potential moves.
+        bool checked;
+
+        // Number of occupied neighbours. Empty cells with any are the frontier,
+        // the only cells that can be moves.
+        unsigned char adjacent;
+
+        // Index of this cell in whiteMove and blackMove, or -1 if it is not a move.
+        short whiteIndex;
+        short blackIndex;
+
         Cell();
     };
 
-    // Struct for the undo stack.
+    // Struct for the undo stack. One is pushed for every move played with undo.
     struct UndoData {
-        Color col;
+        // The played cell, and the color it had before.
         Point coor;
+        Color col;
 
-        UndoData(Color col, Point coor);
+        // The color that was played.
+        Color played;
+
+        // Hash before the move.
+        uint64_t hash;
+
+        // Bitboard: pattern numbers before the move.
+        unsigned short patterns[patterns::INSTANCES];
+
+        // Bitboard: every disc flipped by the move.
+        uint64_t flipped;
+
+        // Cell matrix: where the flipped cells start in undoCells, and how many there are.
+        int start;
+        int count;
     };
 
     // Scores
@@ -48,14 +84,49 @@ private:
     Engine* whiteEngine;
     Engine* blackEngine;
 
-    // Helper variable to keep trach whether a tile is checked for potential moves.
-    bool** _checked;
+    // Where the game is shown. Never null.
+    GameObserver* observer;
 
-    // Matrix to store the current state of the board with the cells.
-    Cell** board;
+    // Matrix to store the current state of the board with the cells, row by row.
+    // Cell (x, y) is at y * size + x.
+    std::vector<Cell> board;
 
     // List to store all the active pieces' coordinates.
-    std::list<Point> activePieces;
+    std::vector<Point> activePieces;
+
+    // Index of every cell in activePieces, or -1 if it is empty.
+    // Indexed by y * size + x, so a piece is removed without searching.
+    std::vector<int> activeIndex;
+
+    // Cells flipped by the moves in the undo stack, only used by the cell matrix.
+    std::vector<Point> undoCells;
+
+    // Cells waiting to be rechecked by updateMovesAround.
+    std::vector<Point> candidates;
+
+    // Whether the 8x8 bitboard is used instead of the cell matrix.
+    // Define OTH_NO_BITBOARD to always use the cell matrix.
+    bool bitboard;
+
+    // Bitboard of each color, indexed by Color. discs[none] is unused.
+    uint64_t discs[3];
+
+    // Whether the wide bitboard is used instead of the cell matrix, on boards
+    // from 9x9 to 16x16. Also turned off by OTH_NO_BITBOARD.
+    bool wide;
+
+    // Wide bitboard of each color, indexed by Color, and of every square of the board.
+    uint64_t wideDiscs[3][wb::WORDS];
+    uint64_t wideBoard[wb::WORDS];
+
+    // Zobrist hash of the pieces, without the turn.
+    uint64_t hash;
+
+    // Where the patterns are on this board size.
+    const patterns::Layout* layout;
+
+    // Number of every pattern instance, kept up to date like the hash.
+    unsigned short patternIndex[patterns::INSTANCES];
 
 
     // Makes everything in checked to be false.
@@ -68,40 +139,101 @@ private:
     // Returns whether the operation is successful.
     bool updatePiece(Color color, int x, int y);
 
+    // Changes the digit of (x, y) in every pattern it is in.
+    void updatePatterns(int x, int y, Color from, Color to);
+
     // Recalculates all possible moves, and puts it in an array.
     void updateValidMoves();
 
-    // Checks if a tile can be placed in this position.
-    void updatePotentialCell(int x, int y);
+    // The cell matrix routines below are templates on the board size N, so their
+    // loops and cell indexes have constant bounds. N = 0 reads size at runtime, for
+    // the sizes without their own copy. pickRoutines chooses the copies of a board.
+
+    // Size of the board, known at compile time when N is not 0.
+    template<int N> int side() const { return N ? N : size; }
+
+    // Gets the cell on (x, y), with the size of N.
+    template<int N> Cell& cellAt(int x, int y) { return board[y * side<N>() + x]; }
+
+    // Flips the cells taken by a piece of color on (x, y), and adds them to undoCells.
+    template<int N> void flipCells(Color color, int x, int y);
+
+    // Rebuilds both move lists from the active pieces.
+    template<int N> void rebuildMoves();
+
+    // Checks if a tile can be placed in this position, and updates both move lists.
+    template<int N> void updatePotentialCell(int x, int y);
+
+    // Adds (x, y) to, or removes it from the move list of color.
+    template<int N> void setMove(Color color, int x, int y, bool valid);
+
+    // Rechecks only the empty cells whose lines pass through the changed cells,
+    // instead of every cell like updateValidMoves.
+    template<int N> void updateMovesAround(Point played, const Point* flipped, int count);
 
     // Walks the board to the specified direction. Will return the color
     // Of something that is different.
-    Color walkBoard(int x, int y, const int* direction);
+    template<int N> Color walkBoard(int x, int y, const int* direction);
+
+    // The wide bitboard versions of flipCells, rebuildMoves and updateMovesAround.
+    // Moves are generated for the whole board at once, which is faster than
+    // rechecking the lines through the changed cells.
+    void flipWide(Color color, int x, int y);
+    void rebuildWide();
+    void updateWideMoves(Point played, const Point* flipped, int count);
+
+    // Puts the squares in mask to the list.
+    static void fillWideMoves(MoveList& list, const wb::Bits& mask);
+
+    // The copies of the routines for this board size.
+    void (Othello::*flipRoutine)(Color color, int x, int y);
+    void (Othello::*rebuildRoutine)();
+    void (Othello::*movesAroundRoutine)(Point played, const Point* flipped, int count);
+    Color (Othello::*walkRoutine)(int x, int y, const int* direction);
+
+    // Points the routines to the copies made for size: 6, 8 and 10 have their own,
+    // and the other sizes share the runtime one. Wide bitboards have their own
+    // routines, and no walkBoard.
+    void pickRoutines();
+
+    // Throws std::logic_error if the move lists are not the same as a full rebuild.
+    // Only called when OTH_CHECK_MOVES is defined.
+    void checkMoves();
+
+    // Gets the cell on (x, y).
+    Cell& cell(int x, int y) { return board[y * size + x]; }
+
+    // Puts the squares in mask to the list.
+    static void fillMoves(MoveList& list, uint64_t mask);
+
+    // Reserves the undo stack for a whole game, so playing never allocates.
+    void reserveUndo();
 
 public:
 
-    // Store potential moves
-    std::list<Point> whiteMove;
-    std::list<Point> blackMove;
+    // Store potential moves. Every move is in the list once.
+    MoveList whiteMove;
+    MoveList blackMove;
+
+    // Largest supported board size, so every move fits in a MoveList.
+    const static int MAXSIZE = 32;
 
     // Board size
     const int size;
-    
-    // Game pauses after "enter" is inputted.
-    bool pauseEveryTurn = true;
 
     // Whose turn is it
     Color turn;
 
-    // Stack to store the undos
-    // The first index of the list is always the move that is played.
-    std::stack<std::list<UndoData>> undos;
+    // Stack to store the undos, with the last played move at the back.
+    // Space for a whole game is reserved up front.
+    std::vector<UndoData> undos;
     
     // Initializes the othello board, with all the variables.
+    // Throws std::invalid_argument if size is not between 4 and MAXSIZE.
     Othello(int size, Engine& whiteEngine, Engine& blackEngine);
 
-    // Deallocate mem
-    ~Othello();
+    // Copies the whole game, so it can be searched on its own.
+    Othello(const Othello& other);
 
     // This function is to add a new piece to the board and nothing else.
     void playPiece(Color color, int x, int y, bool addUndoStack);
@@ -109,18 +241,45 @@ public:
     // Gets the score of the specified color
     int getScore(Color color);
 
+    // Gets the color occupying a cell.
+    Color at(int x, int y);
+
+    // Gets the discs of color as a bitboard, bit y * 8 + x. Only for 8x8 boards.
+    uint64_t getDiscs(Color color);
+
+    // Gets the potential moves of color.
+    const MoveList& getMoves(Color color);
+
+    // Whether the move lists are the same as rebuilding them from scratch.
+    bool movesConsistent();
+
+    // Gets the zobrist hash of the pieces and the turn.
+    uint64_t getHash();
+
+    // Gets the number of a pattern instance, see patterns.h.
+    int getPattern(int instance) { return patternIndex[instance]; }
+
+    // Replaces the whole board, and clears the undo stack.
+    // cells has size * size characters row by row: 'X' is black, 'O' is white, '-' is empty.
+    // Throws std::invalid_argument if the text is not a valid board.
+    void setPosition(const std::string& cells, Color turn);
+
     // Undoes one move, and pops one from the stack.
     void undoMove();
 
-    // Draws the board in the command line.
-    void drawBoard();
+    // Sets where the game is shown. The observer must outlive the game.
+    // Without one, nothing is shown.
+    void setObserver(GameObserver& observer);
+
+    // Gets where the game is shown, so engines can report to it too.
+    GameObserver& getObserver();
 
     // Swaps the turn, and returns the current turn.
     Color switchTurn();
 
-    // Starts the game, with turn being the first color to go.
-    // pauseEveryTurn dictates whether the game needs "enter" input
-    // Everytime a turn is over.
+    // Starts the game, with turn being the first color to go, and plays
+    // until both colors have to pass. Everything is shown through the observer.
+    // Throws std::logic_error if an engine returns an illegal move.
     void startGame(Color turn);
 
     };
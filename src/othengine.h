@@ -2,10 +2,56 @@
 
 #include "othutil.h"
 #include "othello.h"
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <functional>
 
 namespace oth {
     class Othello;
 
+    // Limits for searching one move. Zero means no limit.
+    struct SearchLimits {
+        // Deepest iteration to search, in plies.
+        int depth = 0;
+        // Number of nodes to search.
+        long long nodes = 0;
+        // Time budget, in milliseconds.
+        int moveTime = 0;
+    };
+
+    // What a search knows after one more iteration.
+    struct SearchProgress {
+        int depth = 0;
+        // For the side to move, in the units of the engine.
+        int score = 0;
+        long long nodes = 0;
+        double milliseconds = 0;
+        // Best line, with passes as (-1, -1).
+        std::vector<Point> pv;
+    };
+
+    // How to search one move with Engine::searchMove.
+    struct SearchRequest {
+        SearchLimits limits;
+        // When set from another thread, the search stops soon and returns the best
+        // move it has. It stays set, so a search that has not started yet stops too.
+        const std::atomic<bool>* cancel = nullptr;
+        // Called by the searching thread after every iteration.
+        std::function<void(const SearchProgress&)> progress;
+    };
+
+    // What Engine::searchMove found. Engines that don't search leave the counters at 0.
+    struct SearchResult {
+        Point move;
+        int score = 0;
+        int depth = 0;
+        long long nodes = 0;
+        double milliseconds = 0;
+        // Whether the cancel flag was set before the search ended.
+        bool cancelled = false;
+    };
+
     /*
         Abstract class to contain all the functions to calculate the next move.
         Can be extended to make multiple classes that implements these function.
@@ -18,8 +64,31 @@ private:
 
 public:
 
+        virtual ~Engine() {}
+
         // Returns the coordinates for color's best move.
         // Throws an error if no moves are possible.
         virtual Point nextMove(Othello& board) = 0;
+
+        // Called when the opponent starts thinking on board. The engine may think
+        // ahead on its own, until its next nextMove or stopThinking.
+        // board changes after this returns, so it has to be copied to be used.
+        virtual void opponentThinking(Othello& board) {}
+
+        // Called when the game is over, to stop thinking ahead.
+        virtual void stopThinking() {}
+
+        // Searches the move of board.turn with the limits of request instead of the
+        // engine's own, stopping when its cancel flag is set. board is changed while
+        // searching, and left as it was. By default it is nextMove, which can't be
+        // stopped and ignores the limits.
+        virtual SearchResult searchMove(Othello& board, const SearchRequest& request) {
+            auto start = std::chrono::steady_clock::now();
+            SearchResult result;
+            result.move = nextMove(board);
+            result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            result.cancelled = request.cancel && request.cancel->load();
+            return result;
+        }
     };
 }
\ No newline at end of file
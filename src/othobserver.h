@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include "othutil.h"
+
+namespace oth {
+    class Othello;
+
+    /*
+        Everything a game shows to the outside goes through an observer,
+        so the board and the engines never print on their own.
+        Every function does nothing by default, so observers only pick what they need.
+    */
+    class GameObserver {
+public:
+
+        virtual ~GameObserver() {}
+
+        // The game is about to start, from the current board.
+        virtual void gameStarted(Othello& board) {}
+
+        // The engine of board.turn is about to think.
+        virtual void turnStarted(Othello& board) {}
+
+        // color played move, and the board has it already.
+        virtual void movePlayed(Othello& board, Color color, Point move) {}
+
+        // color has no moves, and gives the turn away.
+        virtual void passed(Othello& board, Color color) {}
+
+        // Nobody can move anymore.
+        virtual void gameOver(Othello& board) {}
+
+        // Free text from an engine, like search info. One line without the newline.
+        virtual void message(const std::string& text) {}
+    };
+
+    // Shows nothing, for games without any output.
+    class NullObserver : public GameObserver {};
+
+    // Shows the game to two observers, first to a and then to b.
+    class SplitObserver : public GameObserver {
+
+        GameObserver& a;
+        GameObserver& b;
+
+public:
+
+        SplitObserver(GameObserver& a, GameObserver& b) : a(a), b(b) {}
+
+        void gameStarted(Othello& board) { a.gameStarted(board); b.gameStarted(board); }
+        void turnStarted(Othello& board) { a.turnStarted(board); b.turnStarted(board); }
+        void movePlayed(Othello& board, Color color, Point move) { a.movePlayed(board, color, move); b.movePlayed(board, color, move); }
+        void passed(Othello& board, Color color) { a.passed(board, color); b.passed(board, color); }
+        void gameOver(Othello& board) { a.gameOver(board); b.gameOver(board); }
+        void message(const std::string& text) { a.message(text); b.message(text); }
+    };
+}
@@ -8,6 +8,9 @@ namespace oth {
 
         Point();
         Point(int x, int y);
+
+        bool operator==(const Point& other) const;
+        bool operator!=(const Point& other) const;
     };
 
     /*
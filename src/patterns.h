@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include "othutil.h"
+
+namespace oth {
+    /*
+        Cell patterns used by the evaluation. Every pattern is a line of cells
+        starting at a corner, read as a number in base 3: an empty cell is 0,
+        black is 1 and white is 2, and cell i of the pattern is digit i.
+
+        Every corner has one instance of each shape, seen from that corner,
+        and the edge shape is taken along both sides. The board keeps the number
+        of every instance up to date while moves are played and undone.
+    */
+    namespace patterns {
+        enum Shape {
+            // 3x3 square in the corner.
+            CORNER,
+            // First 8 cells of an edge, from the corner.
+            EDGE,
+            // First 8 cells of the diagonal, from the corner.
+            DIAGONAL,
+            SHAPES
+        };
+
+        // Instances on every board: 4 corners, 8 edges, 4 diagonals.
+        const int INSTANCES = 16;
+
+        // Shape of every instance.
+        const static int shapeOf[INSTANCES] = {
+            CORNER, CORNER, CORNER, CORNER,
+            EDGE, EDGE, EDGE, EDGE, EDGE, EDGE, EDGE, EDGE,
+            DIAGONAL, DIAGONAL, DIAGONAL, DIAGONAL
+        };
+
+        const static int pow3[10] = { 1, 3, 9, 27, 81, 243, 729, 2187, 6561, 19683 };
+
+        // Number of cells of shape on a board of size. Lines are shorter on small boards.
+        inline int cells(int shape, int size) {
+            if (shape == CORNER) return 9;
+            return size < 8 ? size : 8;
+        }
+
+        // Number of different values of shape.
+        inline int values(int shape, int size) {
+            return pow3[cells(shape, size)];
+        }
+
+        // Where the instances are on one board size.
+        struct Layout {
+            // A cell is digit power (a power of 3) of instance.
+            struct Link {
+                unsigned char instance;
+                unsigned short power;
+            };
+
+            // Links of cell y * size + x are links[start[cell]] up to links[start[cell + 1]].
+            std::vector<int> start;
+            std::vector<Link> links;
+
+            // Cells of every instance, in digit order.
+            std::vector<Point> cells[INSTANCES];
+        };
+
+        // Layout of a board size between 4 and 32. Built once, and shared by every board.
+        const Layout& layout(int size);
+    }
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include "othello.h"
+
+namespace oth {
+    /*
+        Parameters of Multi-ProbCut, the forward pruning of MinimaxEngine.
+
+        The score of a deep search is predicted from a shallow search of the same
+        position, as deep = a * shallow + b, with the error having a standard
+        deviation of sigma. There is a line for every phase of the game and every
+        deep depth, each with its own shallow depth. They are fitted from real
+        searches by tools/fitprobcut.cpp, with the evaluation they are used with.
+
+        Scores are in discs, whatever units the search uses.
+
+        File format, little endian:
+            "OTHP", version (1 byte), board size (1 byte), phases (1 byte), deepest depth (1 byte)
+            then for every phase and every depth from 0 to the deepest: shallow depth
+            (1 byte, 0 if the depth is not cut), then a, b and sigma as 32 bit floats.
+    */
+    class ProbCut {
+public:
+
+        // A deep depth and the shallow search that predicts it.
+        struct Pair {
+            // 0 if the deep depth is never cut.
+            int shallow = 0;
+            double a = 1;
+            double b = 0;
+            double sigma = 0;
+        };
+
+        // Phases of the game, by number of discs.
+        const static int PHASES = 4;
+
+        // Shallowest depth that is cut, so there is a shallower search to predict it.
+        const static int MINDEPTH = 3;
+
+private:
+
+        int boardSize;
+        int maxDepth;
+
+        // Pair of phase p and depth d at p * (maxDepth + 1) + d.
+        std::vector<Pair> pairs;
+
+        const static int VERSION = 1;
+
+        static void writeFloat(std::vector<unsigned char>& bytes, double value) {
+            float f = (float)value;
+            uint32_t u;
+            std::memcpy(&u, &f, 4);
+            for (int i = 0; i < 4; i++) bytes.push_back((u >> (i * 8)) & 0xff);
+        }
+
+        static double readFloat(const unsigned char* bytes) {
+            uint32_t u = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+            float f;
+            std::memcpy(&f, &u, 4);
+            return f;
+        }
+
+public:
+
+        // No depth is cut.
+        ProbCut(int size, int maxDepth) : boardSize(size), maxDepth(maxDepth) {
+            pairs.resize(PHASES * (maxDepth + 1));
+        }
+
+        // Loads the parameters from a file.
+        // Throws std::runtime_error if it can't be read or is not a parameter file.
+        static ProbCut load(const std::string& path) {
+            std::ifstream file(path, std::ios::binary);
+            if (!file) throw std::runtime_error("Can't open " + path);
+
+            unsigned char header[8];
+            if (!file.read((char*)header, sizeof(header)) || std::string((char*)header, 4) != "OTHP") {
+                throw std::runtime_error(path + " is not a probcut file");
+            }
+            if (header[4] != VERSION || header[6] != PHASES) throw std::runtime_error(path + " is a probcut file of another version");
+            if (header[5] < 4 || header[5] > Othello::MAXSIZE) throw std::runtime_error(path + " has a bad board size");
+
+            ProbCut cut(header[5], header[7]);
+
+            std::vector<unsigned char> bytes(cut.pairs.size() * 13);
+            if (!file.read((char*)bytes.data(), bytes.size())) throw std::runtime_error(path + " is too short");
+            for (size_t i = 0; i < cut.pairs.size(); i++) {
+                const unsigned char* at = &bytes[i * 13];
+                Pair& pair = cut.pairs[i];
+                pair.shallow = at[0];
+                pair.a = readFloat(at + 1);
+                pair.b = readFloat(at + 5);
+                pair.sigma = readFloat(at + 9);
+
+                int depth = i % (cut.maxDepth + 1);
+                if (pair.shallow > 0 && (pair.shallow >= depth || pair.a <= 0 || pair.sigma < 0)) {
+                    throw std::runtime_error(path + " has a bad pair for depth " + std::to_string(depth));
+                }
+            }
+
+            return cut;
+        }
+
+        // Writes the parameters to a file. Throws std::runtime_error if it can't be written.
+        void save(const std::string& path) const {
+            std::vector<unsigned char> bytes = { 'O', 'T', 'H', 'P', VERSION, (unsigned char)boardSize, PHASES, (unsigned char)maxDepth };
+            for (size_t i = 0; i < pairs.size(); i++) {
+                bytes.push_back(pairs[i].shallow);
+                writeFloat(bytes, pairs[i].a);
+                writeFloat(bytes, pairs[i].b);
+                writeFloat(bytes, pairs[i].sigma);
+            }
+
+            std::ofstream file(path, std::ios::binary);
+            if (!file.write((const char*)bytes.data(), bytes.size())) throw std::runtime_error("Can't write " + path);
+        }
+
+        // Board size the parameters are for.
+        int size() const {
+            return boardSize;
+        }
+
+        // Deepest depth with parameters.
+        int depth() const {
+            return maxDepth;
+        }
+
+        // Phase of a board with discs pieces on it.
+        int phase(int discs) const {
+            int p = (discs - 4) * PHASES / (boardSize * boardSize - 3);
+            return p < 0 ? 0 : p >= PHASES ? PHASES - 1 : p;
+        }
+
+        Pair& pair(int phase, int depth) {
+            return pairs[phase * (maxDepth + 1) + depth];
+        }
+
+        // Pair of a search to depth on a board with discs pieces, or null if it is not cut.
+        const Pair* find(int discs, int depth) const {
+            if (depth < MINDEPTH || depth > maxDepth) return nullptr;
+            const Pair& pair = pairs[phase(discs) * (maxDepth + 1) + depth];
+            return pair.shallow > 0 ? &pair : nullptr;
+        }
+    };
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include "othutil.h"
+#include "transposition.h"
+
+namespace oth {
+    /*
+        What a search did for one move, filled in while searching.
+        Moves are (x, y) from 0, and passes in a line are (-1, -1).
+    */
+    struct SearchStats {
+
+        // Cutoffs are counted by the index of the move that caused them.
+        // The last slot counts that index and every later one.
+        const static int CUTOFFSLOTS = 8;
+
+        // One iteration of the main searcher.
+        struct Iteration {
+            int depth = 0;
+            // Nodes of this iteration only.
+            long long nodes = 0;
+            double milliseconds = 0;
+            int score = 0;
+            // False if a limit stopped the iteration, so score and pv are partial.
+            bool completed = false;
+            uint64_t tableProbes = 0;
+            uint64_t tableHits = 0;
+            std::vector<Point> pv;
+        };
+
+        Point move;
+        int score = 0;
+        // Whether the move came from the opening book, without a search.
+        bool fromBook = false;
+        // Whether the move was found by the ponder search, started on the opponent's time.
+        bool ponderHit = false;
+        int depthReached = 0;
+        int threads = 0;
+
+        // Nodes of every thread.
+        long long nodes = 0;
+        double milliseconds = 0;
+
+        // Nodes whose moves were searched, and how many of them had a beta cutoff
+        // at each move index. Summed over every thread.
+        long long expandedNodes = 0;
+        long long cutoffs[CUTOFFSLOTS] = {};
+
+        // Nodes pruned by Multi-ProbCut, summed over every thread.
+        long long probCuts = 0;
+
+        // Transposition table counters of every thread.
+        TranspositionTable::Stats table;
+
+        std::vector<Iteration> iterations;
+
+        long long totalCutoffs() const {
+            long long total = 0;
+            for (int i = 0; i < CUTOFFSLOTS; i++) total += cutoffs[i];
+            return total;
+        }
+
+        // Nodes of the last completed iteration over the one before. 0 if there are not two.
+        double branchingFactor() const {
+            const Iteration* last = nullptr;
+            const Iteration* before = nullptr;
+            for (size_t i = 0; i < iterations.size(); i++) {
+                if (!iterations[i].completed) continue;
+                before = last;
+                last = &iterations[i];
+            }
+            return last && before && before->nodes > 0 ? double(last->nodes) / before->nodes : 0;
+        }
+
+        // One line of JSON, without the newline.
+        std::string toJson() const {
+            std::string json = "{\"move\":" + point(move) +
+                ",\"score\":" + std::to_string(score) +
+                ",\"book\":" + (fromBook ? "true" : "false") +
+                ",\"ponder\":" + (ponderHit ? "true" : "false") +
+                ",\"depth\":" + std::to_string(depthReached) +
+                ",\"threads\":" + std::to_string(threads) +
+                ",\"nodes\":" + std::to_string(nodes) +
+                ",\"ms\":" + number(milliseconds) +
+                ",\"nps\":" + number(milliseconds > 0 ? nodes * 1000 / milliseconds : 0) +
+                ",\"ebf\":" + number(branchingFactor()) +
+                ",\"tt\":{\"probes\":" + std::to_string(table.probes) +
+                ",\"hits\":" + std::to_string(table.hits) +
+                ",\"stores\":" + std::to_string(table.stores) +
+                ",\"collisions\":" + std::to_string(table.collisions) + "}" +
+                ",\"cutoffs\":{\"expanded\":" + std::to_string(expandedNodes) +
+                ",\"total\":" + std::to_string(totalCutoffs()) + ",\"byIndex\":[";
+
+            for (int i = 0; i < CUTOFFSLOTS; i++) json += (i ? "," : "") + std::to_string(cutoffs[i]);
+            json += "]},\"probcuts\":" + std::to_string(probCuts) + ",\"iterations\":[";
+
+            for (size_t i = 0; i < iterations.size(); i++) {
+                const Iteration& it = iterations[i];
+                json += (i ? ",{" : "{");
+                json += "\"depth\":" + std::to_string(it.depth) +
+                    ",\"nodes\":" + std::to_string(it.nodes) +
+                    ",\"ms\":" + number(it.milliseconds) +
+                    ",\"score\":" + std::to_string(it.score) +
+                    ",\"completed\":" + (it.completed ? "true" : "false") +
+                    ",\"ttProbes\":" + std::to_string(it.tableProbes) +
+                    ",\"ttHits\":" + std::to_string(it.tableHits) + ",\"pv\":[";
+                for (size_t j = 0; j < it.pv.size(); j++) json += (j ? "," : "") + point(it.pv[j]);
+                json += "]}";
+            }
+            json += "]}";
+
+            return json;
+        }
+
+private:
+
+        static std::string point(const Point& p) {
+            return "[" + std::to_string(p.x) + "," + std::to_string(p.y) + "]";
+        }
+
+        // JSON has no locale, so don't use streams.
+        static std::string number(double value) {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.3f", value);
+            return buffer;
+        }
+    };
+}
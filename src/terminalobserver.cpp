@@ -0,0 +1,211 @@
+#include "othobserver.h"
+#include "othello.h"
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#define RESET "\033[0m"
+#define BLACK "\033[37;40m"
+#define WHITE "\033[30;47m"
+#define EMPTY "\033[34;46m"
+
+#define ANSICOLOR
+
+namespace oth {
+    /*
+        Shows the game in the command line.
+
+        Every event is built in one string, and written with one call.
+        With ANSICOLOR, the board stays at the top of the screen and only the
+        cells that changed are drawn again. The text of the current turn goes
+        below it. Without ANSICOLOR, a plain board is printed after every move.
+    */
+    class TerminalObserver : public GameObserver {
+
+        std::ostream& out;
+
+        // Colors on the screen, so only changed cells are drawn.
+        std::vector<Color> shown;
+
+        // Frame being built.
+        std::string frame;
+
+        // Screen row of the coordinates above the board.
+        int top = 1;
+
+        // Passes since the last turn, shown again after the text below the board is cleared.
+        std::string passes;
+
+        static const char* name(Color color) {
+            return color == white ? "White" : "Black";
+        }
+
+        static const char* symbol(Color color) {
+#ifdef ANSICOLOR
+            switch (color) {
+                case black:
+                    return BLACK "[]" RESET;
+                case white:
+                    return WHITE "[]" RESET;
+                default:
+                    return EMPTY "  " RESET;
+            }
+#else
+            switch (color) {
+                case black:
+                    return "X ";
+                case white:
+                    return "O ";
+                default:
+                    return ". ";
+            }
+#endif
+        }
+
+        // Moves the cursor, counting from 1.
+        void moveTo(int row, int column) {
+            frame += "\033[" + std::to_string(row) + ";" + std::to_string(column) + "H";
+        }
+
+        void scoreLine(Othello& board) {
+            frame += "White: " + std::to_string(board.getScore(white)) +
+                " | Black: " + std::to_string(board.getScore(black));
+        }
+
+        // Draws the whole board, with the coordinates.
+        void drawBoard(Othello& board) {
+            int size = board.size;
+            shown.resize(size * size);
+
+            // Print first row of number coords
+            frame += "  ";
+            for (int i = 0; i < size;) frame += std::to_string((++i) % 10) + " ";
+            frame += "\n";
+
+            for (int y = 0; y < size; y++) {
+                // Print column number coords
+                frame += std::to_string((y + 1) % 10) + " ";
+
+                for (int x = 0; x < size; x++) {
+                    shown[y * size + x] = board.at(x, y);
+                    frame += symbol(shown[y * size + x]);
+                }
+                frame += "\n";
+            }
+
+            scoreLine(board);
+            frame += "\n";
+        }
+
+        // Draws only the cells that changed, and puts the cursor back.
+        void drawChanged(Othello& board) {
+            int size = board.size;
+
+            // Save the cursor.
+            frame += "\0337";
+
+            for (int y = 0; y < size; y++) {
+                for (int x = 0; x < size; x++) {
+                    Color color = board.at(x, y);
+                    if (shown[y * size + x] == color) continue;
+
+                    shown[y * size + x] = color;
+                    moveTo(top + y + 1, x * 2 + 3);
+                    frame += symbol(color);
+                }
+            }
+
+            moveTo(top + size + 1, 1);
+            frame += "\033[2K";
+            scoreLine(board);
+
+            // Restore the cursor.
+            frame += "\0338";
+        }
+
+        // Writes the frame at once.
+        void flush() {
+            out.write(frame.data(), frame.size());
+            out.flush();
+            frame.clear();
+        }
+
+public:
+
+        // Game pauses after "enter" is inputted.
+        bool pauseEveryTurn = true;
+
+        // Text shown above the board, like a welcome message.
+        std::string header;
+
+        TerminalObserver(std::ostream& out = std::cout) : out(out) {}
+
+        void gameStarted(Othello& board) {
+#ifdef ANSICOLOR
+            // Clear the screen, and start at the top.
+            frame += "\033[2J\033[H";
+#endif
+            frame += header;
+            if (!header.empty() && header.back() != '\n') frame += "\n";
+
+            top = 1;
+            for (size_t i = 0; i < header.size(); i++) top += header[i] == '\n';
+            if (!header.empty() && header.back() != '\n') top++;
+
+#ifndef ANSICOLOR
+            frame += "Initial board:\n";
+#endif
+            drawBoard(board);
+            flush();
+        }
+
+        void turnStarted(Othello& board) {
+            if (pauseEveryTurn) {
+                frame += "Press Enter to Continue\n";
+                flush();
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            }
+
+#ifdef ANSICOLOR
+            // Only the text of this turn is kept below the board.
+            moveTo(top + board.size + 2, 1);
+            frame += "\033[J";
+            frame += passes;
+#endif
+            passes.clear();
+            frame += std::string(name(board.turn)) + "'s Turn\n";
+            flush();
+        }
+
+        void movePlayed(Othello& board, Color color, Point move) {
+#ifdef ANSICOLOR
+            drawChanged(board);
+#endif
+            frame += std::string(name(color)) + " Plays (" + std::to_string(move.x + 1) + ", " + std::to_string(move.y + 1) + ")\n";
+#ifndef ANSICOLOR
+            drawBoard(board);
+#endif
+            flush();
+        }
+
+        void passed(Othello& board, Color color) {
+            std::string line = std::string(name(color)) + " has no moves, and passes\n";
+            passes += line;
+            frame += line;
+            flush();
+        }
+
+        void gameOver(Othello& board) {
+            frame += "Game over. ";
+            scoreLine(board);
+            frame += "\n";
+            flush();
+        }
+
+        void message(const std::string& text) {
+            frame += text + "\n";
+            flush();
+        }
+    };
+}
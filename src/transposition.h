@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include "othutil.h"
+
+namespace oth {
+    /*
+        Fixed size hash table of searched positions, keyed by the zobrist hash.
+        Entries are grouped in buckets of one cache line, so a probe touches one line.
+
+        The table can be shared by many threads without locks, even by engines
+        searching different games. Every slot stores key ^ data next to data, so
+        a slot torn by two writers fails the key check and reads as a miss.
+    */
+    class TranspositionTable {
+
+public:
+
+        // What the stored score means.
+        enum Bound : unsigned char {
+            EMPTY,
+            // The score is exact.
+            EXACT,
+            // The real score is at least the stored score (beta cutoff).
+            LOWER,
+            // The real score is at most the stored score (fail low).
+            UPPER
+        };
+
+        // Unpacked entry, as returned by probe.
+        struct Entry {
+            int score;
+            int depth;
+            Bound bound;
+            // (-1, -1) if there is no best move.
+            Point move;
+        };
+
+        // Counters of one searcher. Every thread keeps its own, so they don't share cache lines.
+        struct Stats {
+            uint64_t probes = 0;
+            uint64_t hits = 0;
+            uint64_t stores = 0;
+            // Stores that had to overwrite another position.
+            uint64_t collisions = 0;
+
+            Stats& operator+=(const Stats& other) {
+                probes += other.probes;
+                hits += other.hits;
+                stores += other.stores;
+                collisions += other.collisions;
+                return *this;
+            }
+        };
+
+        // Creates a table that uses about megabytes of memory.
+        TranspositionTable(size_t megabytes) {
+            resize(megabytes);
+        }
+
+        // Reallocates the table to use about megabytes of memory, and clears it.
+        // The bucket count is rounded down to a power of two.
+        void resize(size_t megabytes) {
+            size_t count = 1;
+            while (count * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024) count *= 2;
+
+            buckets.reset(new Bucket[count]);
+            bucketCount = count;
+            mask = count - 1;
+            clear();
+        }
+
+        // Clears every entry, so the table is like a new one. Must not be called while searching.
+        void clear() {
+            age.store(0, std::memory_order_relaxed);
+            for (size_t i = 0; i < bucketCount; i++) {
+                for (int j = 0; j < BUCKETSIZE; j++) {
+                    buckets[i].slots[j].check.store(0, std::memory_order_relaxed);
+                    buckets[i].slots[j].data.store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Starts a new search, so entries of older searches get replaced first.
+        // The age has 6 bits, so a shared table should have it moved on once for
+        // all the engines, not by every search (see MinimaxEngine::setTable).
+        void newSearch() {
+            age.store((age.load(std::memory_order_relaxed) + 1) & AGEMASK, std::memory_order_relaxed);
+        }
+
+        // Looks for the position. Returns whether it was found.
+        bool probe(uint64_t key, Entry& out, Stats& stats) {
+            stats.probes++;
+
+            Bucket& bucket = buckets[key & mask];
+            for (int i = 0; i < BUCKETSIZE; i++) {
+                Slot& slot = bucket.slots[i];
+                uint64_t data = slot.data.load(std::memory_order_relaxed);
+                uint64_t check = slot.check.load(std::memory_order_relaxed);
+
+                if ((check ^ data) == key && bound(data) != EMPTY) {
+                    stats.hits++;
+                    // Refresh the age, so the entry survives this search.
+                    unsigned current = age.load(std::memory_order_relaxed);
+                    if (((data >> AGESHIFT) & AGEMASK) != current) {
+                        data = (data & ~(uint64_t(AGEMASK) << AGESHIFT)) | (uint64_t(current) << AGESHIFT);
+                        write(slot, key, data);
+                    }
+                    out = unpack(data);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        // Stores a searched position.
+        void store(uint64_t key, int score, int depth, Bound bnd, Point move, Stats& stats) {
+            stats.stores++;
+
+            Bucket& bucket = buckets[key & mask];
+            Slot* victim = &bucket.slots[0];
+            int victimWorth = INT32_MAX;
+            unsigned current = age.load(std::memory_order_relaxed);
+
+            for (int i = 0; i < BUCKETSIZE; i++) {
+                Slot& slot = bucket.slots[i];
+                uint64_t data = slot.data.load(std::memory_order_relaxed);
+                uint64_t check = slot.check.load(std::memory_order_relaxed);
+
+                // Same position, overwrite it. Keep the old best move if there is no new one.
+                if ((check ^ data) == key && bound(data) != EMPTY) {
+                    // A deeper entry of this search is kept, unless the new score is exact,
+                    // so shallow searches of helpers or of ProbCut don't throw it away.
+                    // Only its move and age are refreshed.
+                    int storedDepth = (data >> DEPTHSHIFT) & 0xff;
+                    if (storedDepth > depth && ((data >> AGESHIFT) & AGEMASK) == current && bnd != EXACT) {
+                        if (move.x >= 0) {
+                            data = (data & ~(uint64_t(0xffff) << MOVESHIFT)) |
+                                (uint64_t(uint8_t(move.x)) << MOVESHIFT) |
+                                (uint64_t(uint8_t(move.y)) << (MOVESHIFT + 8));
+                            write(slot, key, data);
+                        }
+                        return;
+                    }
+                    if (move.x < 0) move = unpack(data).move;
+                    write(slot, key, pack(score, depth, bnd, move));
+                    return;
+                }
+
+                // Empty slots are always taken first.
+                if (bound(data) == EMPTY) {
+                    victim = &slot;
+                    victimWorth = -1;
+                    continue;
+                }
+
+                // Otherwise replace the shallowest entry, preferring older searches.
+                int worth = ((data >> DEPTHSHIFT) & 0xff) + (((data >> AGESHIFT) & AGEMASK) == current ? 256 : 0);
+                if (worth < victimWorth) {
+                    victim = &slot;
+                    victimWorth = worth;
+                }
+            }
+
+            if (victimWorth >= 0) stats.collisions++;
+
+            write(*victim, key, pack(score, depth, bnd, move));
+        }
+
+        // Number of entries the table can hold.
+        size_t capacity() const { return bucketCount * BUCKETSIZE; }
+
+private:
+
+        // Data layout: score 16 bits, depth 8, bound 2, age 6, move x 8, move y 8.
+        const static int DEPTHSHIFT = 16;
+        const static int BOUNDSHIFT = 24;
+        const static int AGESHIFT = 26;
+        const static int MOVESHIFT = 32;
+        const static unsigned AGEMASK = 0x3f;
+        const static int BUCKETSIZE = 4;
+
+        struct Slot {
+            // key ^ data
+            std::atomic<uint64_t> check;
+            std::atomic<uint64_t> data;
+        };
+
+        // One cache line.
+        struct alignas(64) Bucket {
+            Slot slots[BUCKETSIZE];
+        };
+
+        static void write(Slot& slot, uint64_t key, uint64_t data) {
+            slot.data.store(data, std::memory_order_relaxed);
+            slot.check.store(key ^ data, std::memory_order_relaxed);
+        }
+
+        static Bound bound(uint64_t data) {
+            return Bound((data >> BOUNDSHIFT) & 3);
+        }
+
+        uint64_t pack(int score, int depth, Bound bnd, Point move) const {
+            return uint64_t(uint16_t(int16_t(score))) |
+                (uint64_t(depth & 0xff) << DEPTHSHIFT) |
+                (uint64_t(bnd) << BOUNDSHIFT) |
+                (uint64_t(age.load(std::memory_order_relaxed)) << AGESHIFT) |
+                (uint64_t(uint8_t(move.x)) << MOVESHIFT) |
+                (uint64_t(uint8_t(move.y)) << (MOVESHIFT + 8));
+        }
+
+        static Entry unpack(uint64_t data) {
+            Entry entry;
+            entry.score = int16_t(data & 0xffff);
+            entry.depth = (data >> DEPTHSHIFT) & 0xff;
+            entry.bound = bound(data);
+            entry.move = Point(int8_t((data >> MOVESHIFT) & 0xff), int8_t((data >> (MOVESHIFT + 8)) & 0xff));
+            return entry;
+        }
+
+        std::unique_ptr<Bucket[]> buckets;
+        size_t bucketCount;
+        size_t mask;
+        std::atomic<unsigned> age;
+    };
+}
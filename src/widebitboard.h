@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace oth {
+    /*
+        Bitboards for boards from 9x9 to 16x16, which don't fit in one uint64_t.
+        A board is a bitset of 16 * 16 bits, with square (x, y) in bit y * 16 + x,
+        so the columns and rows past the board size are always empty.
+
+        The 256 bits are one vector of the compiler's vector extension, so every
+        and, or and shift works on the whole board at once: with two SSE2 registers
+        by default, or one AVX2 register when compiled with -mavx2 or -march=native.
+
+        Larger boards would need 1024 bits for a 32 wide row, and rebuilding the
+        moves of those after every move is slower than the incremental cell matrix.
+    */
+    namespace wb {
+        typedef uint64_t Lanes __attribute__((vector_size(32)));
+
+        // Bits of a row, and the 64 bit words of a board.
+        const static int STRIDE = 16;
+        const static int WORDS = 4;
+
+        // Words with the first column of every row in them, and with the last column.
+        const uint64_t firstColumn = 0x0001000100010001ULL;
+        const uint64_t lastColumn = 0x8000800080008000ULL;
+
+        struct Bits {
+            Lanes v;
+
+            static Bits zero() {
+                Bits b;
+                b.v = Lanes{ 0, 0, 0, 0 };
+                return b;
+            }
+
+            // Reads and writes the words of a board, as kept outside of the vector.
+            static Bits load(const uint64_t* words) {
+                Bits b;
+                std::memcpy(&b.v, words, sizeof(b.v));
+                return b;
+            }
+
+            void store(uint64_t* words) const {
+                std::memcpy(words, &v, sizeof(v));
+            }
+
+            uint64_t word(int w) const { return v[w]; }
+
+            bool any() const { return (v[0] | v[1] | v[2] | v[3]) != 0; }
+
+            Bits operator&(const Bits& o) const { Bits r; r.v = v & o.v; return r; }
+            Bits operator|(const Bits& o) const { Bits r; r.v = v | o.v; return r; }
+            Bits operator~() const { Bits r; r.v = ~v; return r; }
+            Bits& operator|=(const Bits& o) { v |= o.v; return *this; }
+
+            // Moves every bit k places up, with 0 < k < 64. The words carry into the next one.
+            Bits up(int k) const {
+                Lanes below = { 0, v[0], v[1], v[2] };
+                Bits r;
+                r.v = (v << k) | (below >> (64 - k));
+                return r;
+            }
+
+            // Moves every bit k places down, with 0 < k < 64.
+            Bits down(int k) const {
+                Lanes above = { v[1], v[2], v[3], 0 };
+                Bits r;
+                r.v = (v >> k) | (above << (64 - k));
+                return r;
+            }
+        };
+
+        inline int square(int x, int y) { return y * STRIDE + x; }
+
+        inline void set(uint64_t* words, int sq) { words[sq >> 6] |= 1ULL << (sq & 63); }
+
+        inline void clear(uint64_t* words, int sq) { words[sq >> 6] &= ~(1ULL << (sq & 63)); }
+
+        inline bool test(const uint64_t* words, int sq) { return (words[sq >> 6] >> (sq & 63)) & 1; }
+
+        // Moves every bit one step to the direction with index i of oth::direction ({y, x}).
+        // Bits going past the first or last column are dropped, so they don't wrap to
+        // the next row. Bits going past the board size are left for the caller to mask.
+        template<int i>
+        inline Bits shift(const Bits& b) {
+            const int dy = i == 0 || i == 1 || i == 2 ? 1 : i == 3 || i == 7 ? 0 : -1;
+            const int dx = i == 0 || i == 6 || i == 7 ? 1 : i == 1 || i == 5 ? 0 : -1;
+            const int k = dy * STRIDE + dx;
+
+            Bits r = k > 0 ? b.up(k) : b.down(-k);
+            if (dx != 0) {
+                uint64_t keep = dx > 0 ? ~firstColumn : ~lastColumn;
+                r.v &= Lanes{ keep, keep, keep, keep };
+            }
+            return r;
+        }
+
+        // Empty squares to the direction with index i, where own flanks a run of opp discs.
+        template<int i>
+        inline Bits movesTo(const Bits& own, const Bits& opp, const Bits& empty) {
+            // Grow the runs of opponent discs from our discs, until none is longer.
+            Bits run = shift<i>(own) & opp;
+            Bits found = Bits::zero();
+            while (run.any()) {
+                Bits next = shift<i>(run);
+                // The square right after a run is a move, if it is empty.
+                found |= next & empty;
+                run = next & opp;
+            }
+            return found;
+        }
+
+        // Returns every empty square where own can flank at least one opp disc.
+        // empty has the empty squares of the board.
+        inline Bits moves(const Bits& own, const Bits& opp, const Bits& empty) {
+            return movesTo<0>(own, opp, empty) | movesTo<1>(own, opp, empty) |
+                movesTo<2>(own, opp, empty) | movesTo<3>(own, opp, empty) |
+                movesTo<4>(own, opp, empty) | movesTo<5>(own, opp, empty) |
+                movesTo<6>(own, opp, empty) | movesTo<7>(own, opp, empty);
+        }
+
+        // Discs flipped to the direction with index i, when own plays on from: the run
+        // of opp discs next to it, if an own disc ends it.
+        template<int i>
+        inline Bits flipsTo(const Bits& own, const Bits& opp, const Bits& from) {
+            Bits line = Bits::zero();
+            Bits cur = shift<i>(from);
+            while ((cur & opp).any()) {
+                line |= cur;
+                cur = shift<i>(cur);
+            }
+            return (cur & own).any() ? line : Bits::zero();
+        }
+
+        // Returns the discs that get flipped when own plays on square sq.
+        inline Bits flips(const Bits& own, const Bits& opp, int sq) {
+            Bits from = Bits::zero();
+            from.v[sq >> 6] = 1ULL << (sq & 63);
+
+            return flipsTo<0>(own, opp, from) | flipsTo<1>(own, opp, from) |
+                flipsTo<2>(own, opp, from) | flipsTo<3>(own, opp, from) |
+                flipsTo<4>(own, opp, from) | flipsTo<5>(own, opp, from) |
+                flipsTo<6>(own, opp, from) | flipsTo<7>(own, opp, from);
+        }
+    }
+}
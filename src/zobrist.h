@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include "othutil.h"
+
+namespace oth {
+    /*
+        Zobrist keys, used to hash a board incrementally.
+        The keys are the same for every board, so hashes can be shared between boards.
+    */
+    namespace zobrist {
+        // Keys are generated for boards up to MAXSIZE x MAXSIZE.
+        // Bigger boards reuse the keys, so they collide more often.
+        const int MAXSIZE = 64;
+
+        // Key of a piece with color on (x, y). The key of none is always 0.
+        uint64_t piece(Color color, int x, int y);
+
+        // Key that is xored in when it is white's turn.
+        uint64_t whiteTurn();
+    }
+}
@@ -0,0 +1,304 @@
+#include "othello.h"
+#include "randomengine.cpp"
+#include "minimaxengine.cpp"
+#include "evaluator.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdlib>
+
+/*
+    Searches every position of a file, and writes the best move, score and node
+    count of each, in the order of the file.
+
+    The file is read as a stream. Workers take positions as they come, and
+    only a window of positions is held at once: the ones being searched, and
+    the finished ones waiting for an earlier one to be written. So files of
+    any length take the same memory.
+
+    Usage: analyze [options] [positions file]
+        -t <threads>  searching threads, each with its own engine (hardware threads)
+        -d <depth>    search depth (8)
+        -n <nodes>    nodes per position, instead of a depth
+        -m <ms>       milliseconds per position, instead of a depth
+        -e <empties>  empties solved exactly on 8x8 (20)
+        -w <file>     search with these pattern weights
+        -h <MB>       transposition table of every engine, cleared for every position (1)
+        -k            keep the table between positions, which is faster, but then a
+                      result can depend on the positions the engine searched before
+        -q <count>    positions held at once (16 per thread)
+        -o <file>     write the results to a file instead of the standard output
+
+    Without a file, positions are read from the standard input. Every line is
+    "<cells> <X|O>", with cells as in Othello::setPosition, and the board size
+    is taken from the cells. Empty lines and lines starting with # are skipped.
+
+    Every position gives one line: "<line> <move> <score> <depth> <nodes>".
+    line is the line number in the input, and move is like d3, "pass" if the side
+    has to pass, or "end" if the game is over. The score is for the side to move,
+    in discs, or in 1/16 discs with pattern weights. A bad line gives
+    "<line> error <reason>". The throughput is written to the standard error.
+*/
+
+// A position waiting for a worker.
+struct Job {
+    long long sequence;
+    long long line;
+    std::string text;
+};
+
+// The result of a job, kept until every earlier one is written.
+struct Slot {
+    bool done = false;
+    std::string output;
+};
+
+// The stream of positions between the reader, the workers and the output.
+struct Pipeline {
+    std::mutex lock;
+    // Signalled when a job is added, or the input ends.
+    std::condition_variable jobAdded;
+    // Signalled when results are written, so the reader can go on.
+    std::condition_variable written;
+
+    std::deque<Job> jobs;
+    bool inputEnded = false;
+
+    // Results by sequence, in a ring of the window size.
+    std::vector<Slot> slots;
+    // Sequence of the next result to write.
+    long long next = 0;
+
+    std::ostream* out;
+
+    long long positions = 0;
+    long long errors = 0;
+    long long nodes = 0;
+};
+
+struct Settings {
+    oth::SearchLimits limits;
+    int endgameEmpties = 20;
+    std::shared_ptr<const oth::PatternEvaluator> evaluator;
+    size_t hashMegabytes = 1;
+    bool keepTable = false;
+};
+
+static std::string name(const oth::Point& move) {
+    return std::string(1, 'a' + move.x) + std::to_string(move.y + 1);
+}
+
+// Searches one line of the input, and returns its output without the line number.
+// Puts the searched nodes in nodes, and returns false if the line is not a position.
+static bool analyzeLine(const std::string& text, oth::MinimaxEngine& engine, std::unique_ptr<oth::Othello>& board,
+        const Settings& settings, std::string& output, long long& nodes) {
+    static oth::RandomEngine random;
+    nodes = 0;
+
+    std::istringstream in(text);
+    std::string cells, side;
+    if (!(in >> cells >> side) || (side != "X" && side != "O")) {
+        output = "error expected <cells> <X|O>";
+        return false;
+    }
+
+    int size = 0;
+    while (size * size < (int)cells.size()) size++;
+    if (size * size != (int)cells.size() || size < 4 || size > oth::Othello::MAXSIZE) {
+        output = "error the cells are not a square board";
+        return false;
+    }
+
+    // Boards are kept, and only made again when the size changes.
+    if (!board || board->size != size) board.reset(new oth::Othello(size, random, random));
+    try {
+        board->setPosition(cells, side == "X" ? oth::black : oth::white);
+    } catch (const std::invalid_argument& e) {
+        output = std::string("error ") + e.what();
+        return false;
+    }
+
+    // A side without moves passes, and the other side is searched instead.
+    std::string move;
+    bool passed = false;
+    if (board->getMoves(board->turn).empty()) {
+        board->switchTurn();
+        passed = true;
+        if (board->getMoves(board->turn).empty()) {
+            oth::Color opp = board->turn == oth::white ? oth::black : oth::white;
+            int score = board->getScore(opp) - board->getScore(board->turn);
+            if (settings.evaluator && settings.evaluator->size() == size) score *= oth::PatternEvaluator::SCALE;
+            output = "end " + std::to_string(score) + " 0 0";
+            return true;
+        }
+    }
+
+    if (!settings.keepTable) engine.clear();
+    oth::Point best = engine.nextMove(*board);
+    const oth::SearchStats& stats = engine.getStats();
+    nodes = stats.nodes;
+
+    output = (passed ? "pass" : name(best)) + " " + std::to_string(passed ? -stats.score : stats.score) + " " +
+        std::to_string(stats.depthReached) + " " + std::to_string(stats.nodes);
+    return true;
+}
+
+// Takes jobs until the input ends, and writes every result that is next in order.
+static void work(Pipeline& pipeline, const Settings& settings) {
+    oth::MinimaxEngine engine(settings.hashMegabytes);
+    engine.verbose = false;
+    engine.setLimits(settings.limits);
+    engine.setEndgameEmpties(settings.endgameEmpties);
+    engine.setEvaluator(settings.evaluator);
+    std::unique_ptr<oth::Othello> board;
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(pipeline.lock);
+            pipeline.jobAdded.wait(lock, [&]() { return !pipeline.jobs.empty() || pipeline.inputEnded; });
+            if (pipeline.jobs.empty()) return;
+            job = std::move(pipeline.jobs.front());
+            pipeline.jobs.pop_front();
+        }
+
+        std::string output;
+        long long nodes;
+        bool ok = analyzeLine(job.text, engine, board, settings, output, nodes);
+
+        std::lock_guard<std::mutex> lock(pipeline.lock);
+        Slot& slot = pipeline.slots[job.sequence % pipeline.slots.size()];
+        slot.done = true;
+        slot.output = std::to_string(job.line) + " " + output;
+        pipeline.positions++;
+        pipeline.errors += !ok;
+        pipeline.nodes += nodes;
+
+        // Write every finished result that is next, which frees its place in the window.
+        bool wrote = false;
+        while (true) {
+            Slot& next = pipeline.slots[pipeline.next % pipeline.slots.size()];
+            if (!next.done) break;
+            *pipeline.out << next.output << '\n';
+            next.done = false;
+            next.output.clear();
+            pipeline.next++;
+            wrote = true;
+        }
+        if (wrote) pipeline.written.notify_all();
+    }
+}
+
+static void usage() {
+    std::cerr << "Usage: analyze [-t threads] [-d depth] [-n nodes] [-m ms] [-e empties] [-w weights] [-h MB] [-k] [-q count] [-o file] [positions file]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+    settings.limits.depth = 8;
+    int threads = std::thread::hardware_concurrency();
+    int window = 0;
+    std::string weightsPath;
+    std::string inPath;
+    std::string outPath;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-k") {
+            settings.keepTable = true;
+        } else if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc) {
+            std::string value = argv[++i];
+            switch (arg[1]) {
+                case 't': threads = std::stoi(value); break;
+                case 'd': settings.limits = oth::SearchLimits(); settings.limits.depth = std::stoi(value); break;
+                case 'n': settings.limits = oth::SearchLimits(); settings.limits.nodes = std::stoll(value); break;
+                case 'm': settings.limits = oth::SearchLimits(); settings.limits.moveTime = std::stoi(value); break;
+                case 'e': settings.endgameEmpties = std::stoi(value); break;
+                case 'w': weightsPath = value; break;
+                case 'h': settings.hashMegabytes = std::stoul(value); break;
+                case 'q': window = std::stoi(value); break;
+                case 'o': outPath = value; break;
+                default: usage(); return 2;
+            }
+        } else if (arg[0] != '-' || arg == "-") {
+            inPath = arg;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (threads < 1) threads = 1;
+    if (window < threads) window = window > 0 ? threads : threads * 16;
+
+    try {
+        if (!weightsPath.empty()) settings.evaluator.reset(new oth::PatternEvaluator(oth::PatternEvaluator::load(weightsPath)));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    std::ifstream inFile;
+    if (!inPath.empty() && inPath != "-") {
+        inFile.open(inPath);
+        if (!inFile) {
+            std::cerr << "Can't open " << inPath << std::endl;
+            return 2;
+        }
+    }
+    std::istream& in = inFile.is_open() ? inFile : std::cin;
+
+    std::ofstream outFile;
+    if (!outPath.empty()) {
+        outFile.open(outPath);
+        if (!outFile) {
+            std::cerr << "Can't write " << outPath << std::endl;
+            return 2;
+        }
+    }
+
+    Pipeline pipeline;
+    pipeline.slots.resize(window);
+    pipeline.out = outFile.is_open() ? (std::ostream*)&outFile : &std::cout;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) pool.emplace_back(work, std::ref(pipeline), std::cref(settings));
+
+    // Read the input, waiting while the window is full.
+    std::string text;
+    long long sequence = 0;
+    for (long long line = 1; std::getline(in, text); line++) {
+        size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string::npos || text[first] == '#') continue;
+
+        std::unique_lock<std::mutex> lock(pipeline.lock);
+        pipeline.written.wait(lock, [&]() { return sequence < pipeline.next + window; });
+        pipeline.jobs.push_back(Job{ sequence++, line, text });
+        pipeline.jobAdded.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pipeline.lock);
+        pipeline.inputEnded = true;
+    }
+    pipeline.jobAdded.notify_all();
+    for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+    pipeline.out->flush();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << pipeline.positions << " positions (" << pipeline.errors << " bad) in " << seconds << "s, "
+        << (long long)(seconds > 0 ? pipeline.positions / seconds : 0) << " positions/s, "
+        << (long long)(seconds > 0 ? pipeline.nodes / seconds : 0) << " nodes/s" << std::endl;
+
+    return pipeline.errors > 0 ? 1 : 0;
+}
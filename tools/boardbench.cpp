@@ -0,0 +1,436 @@
+#include "othello.h"
+#include "randomengine.cpp"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+/*
+    Times the board primitives on their own, in nanoseconds per call, so a change
+    to the board code can be measured before it is accepted.
+
+    Positions come from random games with a fixed seed, so every run and every
+    version times the same boards. They are split in three sets by how full the
+    board is: opening, midgame and endgame. Every primitive is timed over a whole
+    set many times, and the median of the runs is reported with the fastest and
+    slowest run.
+
+        walkBoard         every direction of every empty cell (cell matrix only)
+        updatePiece       putting a disc on every empty cell, and taking it back
+        playPiece         a few moves played from every position
+        undoMove          the same moves taken back
+        updateValidMoves  rebuilding both move lists
+        getScore          the score of both colors
+
+    Usage: boardbench [options]
+        -s <size>      board size (8). 8x8 uses the bitboard, and larger sizes the wide
+                       bitboard, unless built with -DOTH_NO_BITBOARD
+        -n <positions> positions in every set (64)
+        -r <runs>      timed runs of every primitive (15)
+        -x <seed>      seed of the positions (1)
+        -j <file>      write the results as JSON lines, - for the standard output
+        -c <file>      compare with the JSON lines of an earlier run
+        -t <percent>   slowdown over the earlier run that fails the comparison (5)
+
+    With -c, every median is printed next to the earlier one, and the exit code
+    is 1 if any primitive got slower than the threshold.
+*/
+
+namespace oth {
+    // Reaches the private routines of Othello.
+    struct BoardBench {
+        static bool bitboard(Othello& board) {
+            return board.bitboard || board.wide;
+        }
+
+        static Color walkBoard(Othello& board, int x, int y, const int* direction) {
+            return (board.*board.walkRoutine)(x, y, direction);
+        }
+
+        static void updatePiece(Othello& board, Color color, int x, int y) {
+            board.updatePiece(color, x, y);
+        }
+
+        static void updateValidMoves(Othello& board) {
+            board.updateValidMoves();
+        }
+    };
+}
+
+// Plies of the line played from every position by playPiece and undoMove.
+static const int LINEPLIES = 8;
+
+// Shortest time of one timed run of a primitive, so the clock doesn't matter.
+static const double MINRUNNANOSECONDS = 2e6;
+
+// A board to time, with the moves played from it.
+struct BenchPosition {
+    std::unique_ptr<oth::Othello> board;
+    std::vector<oth::Point> line;
+};
+
+struct BenchSet {
+    std::string name;
+    // Range of discs on the boards of the set.
+    int minDiscs;
+    int maxDiscs;
+    std::vector<BenchPosition> positions;
+};
+
+// Time of one pass of a primitive over a set.
+struct Pass {
+    long long ops = 0;
+    double nanoseconds = 0;
+};
+
+struct Result {
+    std::string set;
+    std::string primitive;
+    long long ops;
+    double median;
+    double fastest;
+    double slowest;
+};
+
+// Keeps the compiler from dropping the results.
+static volatile long long sink;
+
+static double since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Plays random moves until the board has discs discs, then picks a line of moves
+// from there. Returns false if the game ended or a side has to pass before.
+static bool randomPosition(std::mt19937& rng, int size, int discs, BenchPosition& position) {
+    static oth::RandomEngine engine;
+    std::unique_ptr<oth::Othello> board(new oth::Othello(size, engine, engine));
+
+    while (board->getScore(oth::black) + board->getScore(oth::white) < discs) {
+        const oth::MoveList& moves = board->getMoves(board->turn);
+        if (moves.empty()) return false;
+
+        oth::Point move = moves[rng() % moves.size()];
+        board->playPiece(board->turn, move.x, move.y, false);
+        board->switchTurn();
+    }
+
+    // The line is found on a copy, so the board stays at the position.
+    oth::Othello copy(*board);
+    position.line.clear();
+    while ((int)position.line.size() < LINEPLIES) {
+        const oth::MoveList& moves = copy.getMoves(copy.turn);
+        if (moves.empty()) break;
+
+        oth::Point move = moves[rng() % moves.size()];
+        copy.playPiece(copy.turn, move.x, move.y, false);
+        copy.switchTurn();
+        position.line.push_back(move);
+    }
+    if (position.line.empty()) return false;
+
+    position.board = std::move(board);
+    return true;
+}
+
+static Pass walkBoard(BenchSet& set) {
+    Pass pass;
+    long long found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t p = 0; p < set.positions.size(); p++) {
+        oth::Othello& board = *set.positions[p].board;
+        for (int y = 0; y < board.size; y++) {
+            for (int x = 0; x < board.size; x++) {
+                if (board.at(x, y) != oth::none) continue;
+                for (int i = 0; i < 8; i++) found += oth::BoardBench::walkBoard(board, x, y, oth::direction[i]);
+                pass.ops += 8;
+            }
+        }
+    }
+    pass.nanoseconds = since(start);
+    sink = found;
+    return pass;
+}
+
+static Pass updatePiece(BenchSet& set) {
+    Pass pass;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t p = 0; p < set.positions.size(); p++) {
+        oth::Othello& board = *set.positions[p].board;
+        for (int y = 0; y < board.size; y++) {
+            for (int x = 0; x < board.size; x++) {
+                if (board.at(x, y) != oth::none) continue;
+                oth::BoardBench::updatePiece(board, board.turn, x, y);
+                oth::BoardBench::updatePiece(board, oth::none, x, y);
+                pass.ops += 2;
+            }
+        }
+    }
+    pass.nanoseconds = since(start);
+    return pass;
+}
+
+// Times playPiece and undoMove over the same lines, each on its own.
+static void playAndUndo(BenchSet& set, Pass& play, Pass& undo) {
+    for (size_t p = 0; p < set.positions.size(); p++) {
+        oth::Othello& board = *set.positions[p].board;
+        const std::vector<oth::Point>& line = set.positions[p].line;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < line.size(); i++) {
+            board.playPiece(board.turn, line[i].x, line[i].y, true);
+            board.switchTurn();
+        }
+        play.nanoseconds += since(start);
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < line.size(); i++) board.undoMove();
+        undo.nanoseconds += since(start);
+
+        play.ops += line.size();
+        undo.ops += line.size();
+    }
+}
+
+static Pass updateValidMoves(BenchSet& set) {
+    Pass pass;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t p = 0; p < set.positions.size(); p++) {
+        oth::BoardBench::updateValidMoves(*set.positions[p].board);
+        pass.ops++;
+    }
+    pass.nanoseconds = since(start);
+    return pass;
+}
+
+static Pass getScore(BenchSet& set) {
+    Pass pass;
+    long long total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t p = 0; p < set.positions.size(); p++) {
+        oth::Othello& board = *set.positions[p].board;
+        for (int i = 0; i < 16; i++) total += board.getScore(oth::black) - board.getScore(oth::white) + i;
+        pass.ops += 32;
+    }
+    pass.nanoseconds = since(start);
+    sink = total;
+    return pass;
+}
+
+static const char* PRIMITIVES[] = { "walkBoard", "updatePiece", "playPiece", "undoMove", "updateValidMoves", "getScore" };
+static const int PRIMITIVECOUNT = 6;
+
+// One pass of every primitive over the set, by name. walkBoard is missing on bitboards.
+static std::map<std::string, Pass> passAll(BenchSet& set, bool cells) {
+    std::map<std::string, Pass> passes;
+    if (cells) passes["walkBoard"] = walkBoard(set);
+    passes["updatePiece"] = updatePiece(set);
+    playAndUndo(set, passes["playPiece"], passes["undoMove"]);
+    passes["updateValidMoves"] = updateValidMoves(set);
+    passes["getScore"] = getScore(set);
+    return passes;
+}
+
+// Times every primitive of a set over runs runs, and adds the results.
+// Every run repeats the passes until the fastest primitive took MINRUNNANOSECONDS.
+static void benchSet(BenchSet& set, bool cells, int runs, std::vector<Result>& results) {
+    // Warm up, and find how many passes make a run long enough.
+    std::map<std::string, Pass> warm = passAll(set, cells);
+    double fastest = 0;
+    for (auto it = warm.begin(); it != warm.end(); ++it) {
+        if (fastest == 0 || it->second.nanoseconds < fastest) fastest = it->second.nanoseconds;
+    }
+    int repeats = fastest > 0 ? (int)(MINRUNNANOSECONDS / fastest) + 1 : 1;
+
+    std::map<std::string, std::vector<double>> perOp;
+    std::map<std::string, long long> ops;
+    for (int run = 0; run < runs; run++) {
+        std::map<std::string, Pass> total;
+        for (int r = 0; r < repeats; r++) {
+            std::map<std::string, Pass> passes = passAll(set, cells);
+            for (auto it = passes.begin(); it != passes.end(); ++it) {
+                total[it->first].ops += it->second.ops;
+                total[it->first].nanoseconds += it->second.nanoseconds;
+            }
+        }
+        for (auto it = total.begin(); it != total.end(); ++it) {
+            perOp[it->first].push_back(it->second.ops > 0 ? it->second.nanoseconds / it->second.ops : 0);
+            ops[it->first] = it->second.ops;
+        }
+    }
+
+    for (int i = 0; i < PRIMITIVECOUNT; i++) {
+        auto found = perOp.find(PRIMITIVES[i]);
+        if (found == perOp.end()) continue;
+
+        std::vector<double>& times = found->second;
+        std::sort(times.begin(), times.end());
+        Result result;
+        result.set = set.name;
+        result.primitive = PRIMITIVES[i];
+        result.ops = ops[PRIMITIVES[i]];
+        result.median = times[times.size() / 2];
+        result.fastest = times.front();
+        result.slowest = times.back();
+        results.push_back(result);
+    }
+}
+
+static std::string number(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f", value);
+    return buffer;
+}
+
+static std::string toJson(const Result& result, int size, bool bitboard) {
+    return "{\"set\":\"" + result.set + "\",\"primitive\":\"" + result.primitive +
+        "\",\"size\":" + std::to_string(size) + ",\"bitboard\":" + (bitboard ? "true" : "false") +
+        ",\"ops\":" + std::to_string(result.ops) + ",\"ns\":" + number(result.median) +
+        ",\"min\":" + number(result.fastest) + ",\"max\":" + number(result.slowest) + "}";
+}
+
+// Gets the text after "key": in a JSON line, up to the next comma or brace, without quotes.
+static std::string field(const std::string& line, const std::string& key) {
+    size_t at = line.find("\"" + key + "\":");
+    if (at == std::string::npos) return "";
+    at += key.size() + 3;
+    size_t end = line.find_first_of(",}", at);
+    std::string value = line.substr(at, end == std::string::npos ? std::string::npos : end - at);
+    if (value.size() >= 2 && value.front() == '"') value = value.substr(1, value.size() - 2);
+    return value;
+}
+
+static void usage() {
+    std::cerr << "Usage: boardbench [-s size] [-n positions] [-r runs] [-x seed] [-j file] [-c file] [-t percent]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int size = 8;
+    int count = 64;
+    int runs = 15;
+    unsigned seed = 1;
+    std::string jsonPath;
+    std::string comparePath;
+    double threshold = 5;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc) {
+            std::string value = argv[++i];
+            switch (arg[1]) {
+                case 's': size = std::stoi(value); break;
+                case 'n': count = std::stoi(value); break;
+                case 'r': runs = std::stoi(value); break;
+                case 'x': seed = std::stoul(value); break;
+                case 'j': jsonPath = value; break;
+                case 'c': comparePath = value; break;
+                case 't': threshold = std::stod(value); break;
+                default: usage(); return 2;
+            }
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (size < 6 || size > oth::Othello::MAXSIZE || size % 2 != 0) {
+        std::cerr << "Size must be even, and between 6 and " << oth::Othello::MAXSIZE << std::endl;
+        return 2;
+    }
+    if (count < 1) count = 1;
+    if (runs < 1) runs = 1;
+
+    // Earlier medians, by size, bitboard, set and primitive.
+    std::map<std::string, double> earlier;
+    if (!comparePath.empty()) {
+        std::ifstream file(comparePath);
+        if (!file) {
+            std::cerr << "Can't open " << comparePath << std::endl;
+            return 2;
+        }
+        for (std::string line; std::getline(file, line);) {
+            std::string key = field(line, "size") + " " + field(line, "bitboard") + " " + field(line, "set") + " " + field(line, "primitive");
+            earlier[key] = std::atof(field(line, "ns").c_str());
+        }
+    }
+
+    int cells = size * size;
+    std::vector<BenchSet> sets(3);
+    sets[0].name = "opening";
+    sets[0].minDiscs = 8;
+    sets[0].maxDiscs = 16;
+    sets[1].name = "midgame";
+    sets[1].minDiscs = cells * 2 / 5;
+    sets[1].maxDiscs = cells * 3 / 5;
+    sets[2].name = "endgame";
+    sets[2].minDiscs = cells - 14;
+    sets[2].maxDiscs = cells - 8;
+
+    std::mt19937 rng(seed);
+    for (size_t s = 0; s < sets.size(); s++) {
+        BenchSet& set = sets[s];
+        while ((int)set.positions.size() < count) {
+            BenchPosition position;
+            int discs = set.minDiscs + rng() % (set.maxDiscs - set.minDiscs + 1);
+            if (randomPosition(rng, size, discs, position)) set.positions.push_back(std::move(position));
+        }
+    }
+
+    bool bitboard = oth::BoardBench::bitboard(*sets[0].positions[0].board);
+    std::cout << size << "x" << size << ", " << (bitboard ? size > 8 ? "wide bitboard" : "bitboard" : "cell matrix") << ", "
+        << count << " positions per set, median of " << runs << " runs" << std::endl;
+
+    std::vector<Result> results;
+    for (size_t s = 0; s < sets.size(); s++) benchSet(sets[s], !bitboard, runs, results);
+
+    std::cout << "set      primitive             ns/op       min       max";
+    if (!comparePath.empty()) std::cout << "   earlier   change";
+    std::cout << std::endl;
+
+    bool slower = false;
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& result = results[i];
+        std::cout << std::left << std::setw(9) << result.set << std::setw(18) << result.primitive << std::right
+            << std::fixed << std::setprecision(2)
+            << std::setw(10) << result.median << std::setw(10) << result.fastest << std::setw(10) << result.slowest;
+
+        if (!comparePath.empty()) {
+            auto found = earlier.find(std::to_string(size) + " " + (bitboard ? "true" : "false") + " " + result.set + " " + result.primitive);
+            if (found == earlier.end() || found->second <= 0) {
+                std::cout << "         -        -";
+            } else {
+                double change = (result.median / found->second - 1) * 100;
+                std::cout << std::setw(10) << found->second << std::setw(8) << std::setprecision(1) << std::showpos
+                    << change << "%" << std::noshowpos;
+                if (change > threshold) {
+                    std::cout << "  SLOWER";
+                    slower = true;
+                }
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    if (!jsonPath.empty()) {
+        std::ofstream file;
+        if (jsonPath != "-") {
+            file.open(jsonPath);
+            if (!file) {
+                std::cerr << "Can't write " << jsonPath << std::endl;
+                return 2;
+            }
+        }
+        std::ostream& out = jsonPath == "-" ? std::cout : file;
+        for (size_t i = 0; i < results.size(); i++) out << toJson(results[i], size, bitboard) << '\n';
+    }
+
+    if (slower) std::cout << "Some primitives are more than " << threshold << "% slower" << std::endl;
+    return slower ? 1 : 0;
+}
@@ -0,0 +1,213 @@
+#include "othello.h"
+#include "randomengine.cpp"
+#include "minimaxengine.cpp"
+#include "evaluator.h"
+#include "book.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstdlib>
+
+/*
+    Builds an opening book from self-play, and writes it to a book file.
+
+    Games start with random moves, then a shallow search plays them out, so
+    many openings are seen. Every position of the first plies is counted, a
+    position and its rotations and mirrors being the same one. Positions seen
+    often enough are searched deeper, and their best move goes to the book.
+
+    Usage: buildbook [options] <output file>
+        -g <games>    self-play games (2000)
+        -p <plies>    plies of every game that may go to the book (10)
+        -r <plies>    random moves at the start of every game (4)
+        -m <times>    times a position has to be seen to go to the book (2)
+        -d <depth>    search depth of the book moves (10)
+        -t <threads>  threads playing and searching (hardware threads)
+        -s <size>     board size (8)
+        -w <file>     search with these pattern weights
+        -x <seed>     seed of the random moves (1)
+*/
+
+// A position seen in the games, on its own board as first seen.
+struct Seen {
+    std::string cells;
+    oth::Color turn;
+    int times;
+};
+
+static std::string cellsOf(oth::Othello& board) {
+    std::string cells;
+    for (int y = 0; y < board.size; y++) {
+        for (int x = 0; x < board.size; x++) {
+            oth::Color c = board.at(x, y);
+            cells += c == oth::black ? 'X' : c == oth::white ? 'O' : '-';
+        }
+    }
+    return cells;
+}
+
+// Plays one game, and returns the key of every position up to plies, with the position.
+static std::vector<std::pair<uint64_t, Seen>> playGame(oth::MinimaxEngine& engine, int size, int plies, int randomPlies, unsigned seed) {
+    std::mt19937 rng(seed);
+    oth::RandomEngine random;
+    oth::Othello board(size, random, random);
+
+    std::vector<std::pair<uint64_t, Seen>> positions;
+    bool passed = false;
+    for (int ply = 0; ply < plies;) {
+        const oth::MoveList& moves = board.getMoves(board.turn);
+        if (moves.empty()) {
+            if (passed) break;
+            passed = true;
+            board.switchTurn();
+            continue;
+        }
+        passed = false;
+
+        int symmetry;
+        positions.push_back(std::make_pair(oth::OpeningBook::key(board, symmetry), Seen{ cellsOf(board), board.turn, 1 }));
+
+        oth::Point move = ply < randomPlies ? moves[rng() % moves.size()] : engine.nextMove(board);
+        board.playPiece(board.turn, move.x, move.y, false);
+        board.switchTurn();
+        ply++;
+    }
+
+    return positions;
+}
+
+static void usage() {
+    std::cerr << "Usage: buildbook [-g games] [-p plies] [-r plies] [-m times] [-d depth] [-t threads] [-s size] [-w weights] [-x seed] <output file>" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int games = 2000;
+    int plies = 10;
+    int randomPlies = 4;
+    int minTimes = 2;
+    int depth = 10;
+    int threads = std::thread::hardware_concurrency();
+    int size = 8;
+    unsigned seed = 1;
+    std::string weightsPath;
+    std::string outPath;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc) {
+            std::string value = argv[++i];
+            switch (arg[1]) {
+                case 'g': games = std::stoi(value); break;
+                case 'p': plies = std::stoi(value); break;
+                case 'r': randomPlies = std::stoi(value); break;
+                case 'm': minTimes = std::stoi(value); break;
+                case 'd': depth = std::stoi(value); break;
+                case 't': threads = std::stoi(value); break;
+                case 's': size = std::stoi(value); break;
+                case 'w': weightsPath = value; break;
+                case 'x': seed = std::stoul(value); break;
+                default: usage(); return 2;
+            }
+        } else {
+            outPath = arg;
+        }
+    }
+
+    if (outPath.empty()) {
+        usage();
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+
+    std::shared_ptr<const oth::PatternEvaluator> evaluator;
+    try {
+        if (!weightsPath.empty()) evaluator.reset(new oth::PatternEvaluator(oth::PatternEvaluator::load(weightsPath)));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    // Play the games. Every game has its own seed, so the thread count doesn't change them.
+    std::vector<std::vector<std::pair<uint64_t, Seen>>> played(games);
+    std::atomic<int> next(0);
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([&]() {
+            oth::MinimaxEngine engine(4);
+            engine.verbose = false;
+            oth::SearchLimits limits;
+            limits.depth = 4;
+            engine.setLimits(limits);
+            engine.setEvaluator(evaluator);
+
+            for (int game = next++; game < games; game = next++) {
+                played[game] = playGame(engine, size, plies, randomPlies, seed * 1000003u + game);
+            }
+        });
+    }
+    for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+
+    std::map<uint64_t, Seen> seen;
+    for (int game = 0; game < games; game++) {
+        for (size_t i = 0; i < played[game].size(); i++) {
+            auto found = seen.insert(played[game][i]);
+            if (!found.second) found.first->second.times++;
+        }
+    }
+
+    std::vector<const Seen*> chosen;
+    for (auto it = seen.begin(); it != seen.end(); ++it) {
+        if (it->second.times >= minTimes) chosen.push_back(&it->second);
+    }
+
+    std::cout << seen.size() << " positions seen, " << chosen.size() << " seen " << minTimes << " times or more" << std::endl;
+
+    // Search the chosen positions.
+    std::vector<oth::OpeningBook::Entry> entries(chosen.size());
+    next = 0;
+    pool.clear();
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([&]() {
+            oth::MinimaxEngine engine;
+            engine.verbose = false;
+            oth::SearchLimits limits;
+            limits.depth = depth;
+            engine.setLimits(limits);
+            engine.setEvaluator(evaluator);
+
+            oth::RandomEngine random;
+            for (int i = next++; i < (int)chosen.size(); i = next++) {
+                oth::Othello board(size, random, random);
+                board.setPosition(chosen[i]->cells, chosen[i]->turn);
+
+                // Entries of other positions would make the score deeper than depth.
+                engine.getTable().clear();
+                oth::Point move = engine.nextMove(board);
+                int score = engine.getStats().score;
+
+                // The book keeps the move on the board of the key.
+                int symmetry;
+                entries[i].key = oth::OpeningBook::key(board, symmetry);
+                entries[i].move = oth::OpeningBook::transform(move, symmetry, size);
+                entries[i].score = evaluator && evaluator->size() == size ?
+                    score * oth::OpeningBook::SCALE / oth::PatternEvaluator::SCALE : score * oth::OpeningBook::SCALE;
+            }
+        });
+    }
+    for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+
+    try {
+        oth::OpeningBook::save(outPath, size, entries);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << entries.size() << " positions to " << outPath << std::endl;
+    return 0;
+}
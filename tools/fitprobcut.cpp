@@ -0,0 +1,388 @@
+#include "othello.h"
+#include "randomengine.cpp"
+#include "minimaxengine.cpp"
+#include "evaluator.h"
+#include "gamerecord.h"
+#include "probcut.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+/*
+    Fits the Multi-ProbCut parameters of MinimaxEngine from real searches, and
+    writes them to a probcut file. Or with -c, checks a probcut file.
+
+    Positions are taken from the games of an archive (see tools/records), spread
+    evenly over it. Each one is searched to the deepest depth with a cleared table
+    and no solver, and the score of every iteration is kept. For every phase and
+    deep depth d, the scores at d are fitted by least squares against the scores
+    at a shallow depth of the same parity, about d / 2. Its standard error is sigma.
+
+    Usage: fitprobcut [options] <archive> <probcut file>
+        -d <depth>    deepest depth fitted (10), or the depth of the reference with -c
+        -p <count>    positions taken from the archive (2000)
+        -m <count>    fewest positions for a pair, or the depth is not cut (50)
+        -t <threads>  searching threads, each with its own engine (hardware threads)
+        -w <file>     search with these pattern weights, as the engine will
+        -c <ms>       check the probcut file instead of writing it: search other
+                      positions of the archive this many ms with and without it
+
+    A check searches the positions between the fitted ones. It writes the mean
+    depth reached and the nodes per second of both searches, how often they play
+    the move of the reference search, and the mean score their moves lose against
+    it. The reference search goes to -d plies, which should be deeper than the
+    checked searches reach, and its score of a move is the one of the position
+    after it. Losses are in discs.
+*/
+
+// A position of the archive, and the side to move.
+struct Position {
+    std::string cells;
+    oth::Color turn;
+    int discs;
+};
+
+// Keeps the position after every move of a replayed game.
+class PositionCollector : public oth::GameObserver {
+public:
+    std::vector<Position> positions;
+
+    void movePlayed(oth::Othello& board, oth::Color color, oth::Point move) {
+        std::string cells;
+        for (int y = 0; y < board.size; y++) {
+            for (int x = 0; x < board.size; x++) {
+                oth::Color c = board.at(x, y);
+                cells += c == oth::black ? 'X' : c == oth::white ? 'O' : '-';
+            }
+        }
+        oth::Color next = color == oth::white ? oth::black : oth::white;
+        positions.push_back(Position{ cells, next, board.getScore(oth::white) + board.getScore(oth::black) });
+    }
+};
+
+// What a check found for one position, with and without probcut.
+struct Checked {
+    bool ok = false;
+    int depth[2];
+    long long nodes[2];
+    double milliseconds[2];
+    bool agrees[2];
+    double loss[2];
+};
+
+static void usage() {
+    std::cerr << "Usage: fitprobcut [-d depth] [-p count] [-m count] [-t threads] [-w weights] [-c ms] <archive> <probcut file>" << std::endl;
+}
+
+// Shallow depth that predicts depth: about half of it, with the same parity.
+static int shallowDepth(int depth) {
+    int shallow = (depth + 1) / 2;
+    if ((shallow - depth) % 2 != 0) shallow--;
+    return shallow;
+}
+
+// Searches board to depth with a cleared table, and returns the score for the side to move.
+static int searchTo(oth::MinimaxEngine& engine, oth::Othello& board, int depth, oth::Point& move) {
+    oth::SearchLimits limits;
+    limits.depth = depth;
+    engine.setLimits(limits);
+    engine.clear();
+    move = engine.nextMove(board);
+    return engine.getStats().score;
+}
+
+// Score for the side to move of playing move on board, with a search to depth after it.
+static int scoreAfter(oth::MinimaxEngine& engine, oth::Othello& board, const oth::Point& move, int depth, double scale) {
+    oth::Color color = board.turn;
+    board.playPiece(color, move.x, move.y, true);
+    board.switchTurn();
+
+    int score;
+    oth::Point reply;
+    if (!board.getMoves(board.turn).empty()) {
+        score = -searchTo(engine, board, depth, reply);
+    } else {
+        // The opponent passes, so the side that moved searches again.
+        board.switchTurn();
+        if (!board.getMoves(board.turn).empty()) {
+            score = searchTo(engine, board, depth, reply);
+        } else {
+            oth::Color opp = color == oth::white ? oth::black : oth::white;
+            score = (board.getScore(color) - board.getScore(opp)) * scale;
+        }
+        board.switchTurn();
+    }
+
+    board.undoMove();
+    return score;
+}
+
+int main(int argc, char** argv) {
+    int maxDepth = 10;
+    int count = 2000;
+    int minSamples = 50;
+    int threads = std::thread::hardware_concurrency();
+    int checkTime = 0;
+    std::string weightsPath;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc) {
+            std::string value = argv[++i];
+            switch (arg[1]) {
+                case 'd': maxDepth = std::stoi(value); break;
+                case 'p': count = std::stoi(value); break;
+                case 'm': minSamples = std::stoi(value); break;
+                case 't': threads = std::stoi(value); break;
+                case 'w': weightsPath = value; break;
+                case 'c': checkTime = std::stoi(value); break;
+                default: usage(); return 2;
+            }
+        } else {
+            paths.push_back(arg);
+        }
+    }
+
+    if (paths.size() != 2 || maxDepth < oth::ProbCut::MINDEPTH || maxDepth > 60 || count < 1) {
+        usage();
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+
+    // Every position of the archive, then the ones fitted or checked.
+    std::vector<Position> all;
+    int size = 0;
+    std::shared_ptr<const oth::PatternEvaluator> evaluator;
+    std::shared_ptr<const oth::ProbCut> checked;
+    try {
+        if (!weightsPath.empty()) evaluator.reset(new oth::PatternEvaluator(oth::PatternEvaluator::load(weightsPath)));
+        if (checkTime > 0) checked.reset(new oth::ProbCut(oth::ProbCut::load(paths[1])));
+
+        oth::GameReader reader(paths[0]);
+        oth::GameRecord record;
+        oth::RandomEngine random;
+        std::unique_ptr<oth::Othello> board;
+        PositionCollector collector;
+        while (reader.next(record)) {
+            // The first size in the archive is the one fitted.
+            if (size == 0) size = record.size;
+            if (record.size != size) continue;
+            if (!board) board.reset(new oth::Othello(size, random, random));
+            collector.positions.clear();
+            record.replay(*board, collector);
+
+            // The last position has no moves left to search.
+            if (!collector.positions.empty()) collector.positions.pop_back();
+            all.insert(all.end(), collector.positions.begin(), collector.positions.end());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    if (checked && checked->size() != size) {
+        std::cerr << paths[1] << " is for " << checked->size() << "x" << checked->size() << ", and the archive for " << size << "x" << size << std::endl;
+        return 2;
+    }
+
+    // Evenly spread positions. A check takes the ones halfway between, which were not fitted.
+    double stride = all.size() > (size_t)count ? double(all.size()) / count : 1;
+    std::vector<const Position*> chosen;
+    for (double at = checked ? stride / 2 : 0; at < all.size() && (int)chosen.size() < count; at += stride) {
+        chosen.push_back(&all[(size_t)at]);
+    }
+    if (chosen.empty()) {
+        std::cerr << paths[0] << " has no positions" << std::endl;
+        return 2;
+    }
+
+    bool scaled = evaluator && evaluator->size() == size;
+    double scale = scaled ? oth::PatternEvaluator::SCALE : 1;
+
+    std::atomic<int> next(0);
+    std::vector<std::thread> pool;
+    auto start = std::chrono::steady_clock::now();
+
+    if (checked) {
+        std::vector<Checked> results(chosen.size());
+        for (int t = 0; t < threads; t++) {
+            pool.emplace_back([&]() {
+                oth::MinimaxEngine engine;
+                engine.verbose = false;
+                engine.setThreads(1);
+                engine.setEvaluator(evaluator);
+                engine.setEndgameEmpties(0);
+
+                oth::RandomEngine random;
+                oth::Othello board(size, random, random);
+                for (int i = next++; i < (int)chosen.size(); i = next++) {
+                    board.setPosition(chosen[i]->cells, chosen[i]->turn);
+                    if (board.getMoves(board.turn).empty()) continue;
+                    Checked& result = results[i];
+
+                    // The reference: the best move, and the score of every move that is played.
+                    engine.setProbCut(nullptr);
+                    oth::Point best;
+                    int bestScore = searchTo(engine, board, maxDepth, best);
+
+                    for (int cut = 0; cut < 2; cut++) {
+                        engine.setProbCut(cut ? checked : nullptr);
+                        oth::SearchLimits limits;
+                        limits.moveTime = checkTime;
+                        engine.setLimits(limits);
+                        engine.clear();
+                        oth::Point move = engine.nextMove(board);
+                        const oth::SearchStats& stats = engine.getStats();
+                        result.depth[cut] = stats.depthReached;
+                        result.nodes[cut] = stats.nodes;
+                        result.milliseconds[cut] = stats.milliseconds;
+                        result.agrees[cut] = move == best;
+                        result.loss[cut] = 0;
+
+                        if (!result.agrees[cut]) {
+                            engine.setProbCut(nullptr);
+                            result.loss[cut] = (bestScore - scoreAfter(engine, board, move, maxDepth - 1, scale)) / scale;
+                        }
+                    }
+                    result.ok = true;
+                }
+            });
+        }
+        for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+
+        int positions = 0;
+        double depth[2] = {}, milliseconds[2] = {}, loss[2] = {};
+        long long nodes[2] = {}, agrees[2] = {};
+        for (size_t i = 0; i < results.size(); i++) {
+            if (!results[i].ok) continue;
+            positions++;
+            for (int cut = 0; cut < 2; cut++) {
+                depth[cut] += results[i].depth[cut];
+                nodes[cut] += results[i].nodes[cut];
+                milliseconds[cut] += results[i].milliseconds[cut];
+                agrees[cut] += results[i].agrees[cut];
+                loss[cut] += results[i].loss[cut];
+            }
+        }
+        if (positions == 0) {
+            std::cerr << "No position to check" << std::endl;
+            return 1;
+        }
+
+        std::cout << positions << " positions, " << checkTime << "ms each, reference depth " << maxDepth << std::endl;
+        std::cout << "           depth  nodes/s  same move  loss" << std::endl;
+        for (int cut = 0; cut < 2; cut++) {
+            std::cout << (cut ? "probcut  " : "full     ") << std::fixed
+                << std::setw(7) << std::setprecision(2) << depth[cut] / positions
+                << std::setw(9) << (long long)(milliseconds[cut] > 0 ? nodes[cut] * 1000 / milliseconds[cut] : 0)
+                << std::setw(10) << std::setprecision(1) << 100.0 * agrees[cut] / positions << "%"
+                << std::setw(6) << std::setprecision(2) << loss[cut] / positions << std::endl;
+        }
+        return 0;
+    }
+
+    // Scores in discs of every chosen position at every depth, if it got there.
+    std::vector<std::vector<double>> scores(chosen.size());
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([&]() {
+            oth::MinimaxEngine engine;
+            engine.verbose = false;
+            engine.setThreads(1);
+            engine.setEvaluator(evaluator);
+            // The solver would give scores that are not from the evaluation.
+            engine.setEndgameEmpties(0);
+
+            oth::RandomEngine random;
+            oth::Othello board(size, random, random);
+            for (int i = next++; i < (int)chosen.size(); i = next++) {
+                board.setPosition(chosen[i]->cells, chosen[i]->turn);
+                if (board.getMoves(board.turn).empty()) continue;
+
+                oth::Point move;
+                searchTo(engine, board, maxDepth, move);
+                const oth::SearchStats& stats = engine.getStats();
+
+                // Searches that reach the end of the game early are of no use.
+                if (stats.depthReached < maxDepth) continue;
+                std::vector<double>& line = scores[i];
+                line.assign(maxDepth + 1, 0);
+                for (size_t j = 0; j < stats.iterations.size(); j++) {
+                    const oth::SearchStats::Iteration& it = stats.iterations[j];
+                    if (it.completed && it.depth <= maxDepth) line[it.depth] = it.score / scale;
+                }
+            }
+        });
+    }
+    for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    oth::ProbCut cut(size, maxDepth);
+    int fitted = 0;
+    std::cout << "phase depth shallow      a       b   sigma  samples" << std::endl;
+    for (int phase = 0; phase < oth::ProbCut::PHASES; phase++) {
+        for (int depth = oth::ProbCut::MINDEPTH; depth <= maxDepth; depth++) {
+            int shallow = shallowDepth(depth);
+
+            double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+            for (size_t i = 0; i < chosen.size(); i++) {
+                if (scores[i].empty() || cut.phase(chosen[i]->discs) != phase) continue;
+                double x = scores[i][shallow], y = scores[i][depth];
+                n++;
+                sx += x;
+                sy += y;
+                sxx += x * x;
+                sxy += x * y;
+            }
+
+            std::cout << std::setw(5) << phase << std::setw(6) << depth << std::setw(8) << shallow;
+            double spread = n * sxx - sx * sx;
+            if (n < minSamples || spread <= 0) {
+                std::cout << "  too few positions (" << (long long)n << ")" << std::endl;
+                continue;
+            }
+
+            double a = (n * sxy - sx * sy) / spread;
+            double b = (sy - a * sx) / n;
+            double squares = 0;
+            for (size_t i = 0; i < chosen.size(); i++) {
+                if (scores[i].empty() || cut.phase(chosen[i]->discs) != phase) continue;
+                double error = scores[i][depth] - (a * scores[i][shallow] + b);
+                squares += error * error;
+            }
+            double sigma = std::sqrt(squares / (n - 2));
+
+            std::cout << std::fixed << std::setprecision(3) << std::setw(8) << a << std::setw(8) << b
+                << std::setw(8) << sigma << std::setw(9) << (long long)n;
+            if (a <= 0) {
+                std::cout << "  not cut, the scores don't follow" << std::endl;
+                continue;
+            }
+            std::cout << std::endl;
+
+            oth::ProbCut::Pair& pair = cut.pair(phase, depth);
+            pair.shallow = shallow;
+            pair.a = a;
+            pair.b = b;
+            pair.sigma = sigma;
+            fitted++;
+        }
+    }
+
+    try {
+        cut.save(paths[1]);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    std::cerr << chosen.size() << " positions searched in " << seconds << "s, " << fitted << " pairs fitted" << std::endl;
+    return 0;
+}
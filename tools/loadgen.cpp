@@ -0,0 +1,198 @@
+#include "othello.h"
+#include "randomengine.cpp"
+#include "minimaxengine.cpp"
+#include "evaluator.h"
+#include "book.h"
+#include "gamehost.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+/*
+    Load test of GameHost: keeps a number of games going at once on a fixed
+    pool of workers, and measures the move latency and the throughput. This is
+    repeated for every concurrency level, so it shows how the host behaves as
+    the load rises.
+
+    Every level runs for a fixed time, and a new game starts whenever one ends.
+    Every engine shares one transposition table, and the book if there is one.
+    Games start from random openings.
+
+    Usage: loadgen [options]
+        -c <levels>   games at once, comma separated (1,10,100,1000)
+        -t <workers>  worker threads (hardware threads)
+        -l <seconds>  time of every level (5)
+        -d <depth>    depth of every move (4), 0 for only the clock
+        -b <ms>       clock of every side for the whole game (60000)
+        -h <MB>       shared transposition table (64)
+        -s <size>     board size (8)
+        -r <plies>    random moves in every opening (8)
+        -w <file>     search with these pattern weights
+        -k <file>     play the openings of this book
+        -x <seed>     seed of the random openings (1)
+
+    Every level gives one line: games at once, moves/s, games/s, the 50th and
+    99th percentile of the move latency in ms, the games lost on time, and the
+    games forfeited by an illegal move. The latency of a move runs from when its
+    game was ready for it to when it was played, so it counts the wait for a
+    free worker.
+*/
+
+// Plays random moves from the start. Stops early if someone has to pass.
+static std::vector<oth::Point> randomOpening(int size, int plies, std::mt19937& rng) {
+    oth::RandomEngine engine;
+    oth::Othello board(size, engine, engine);
+    std::vector<oth::Point> opening;
+
+    for (int i = 0; i < plies; i++) {
+        const oth::MoveList& moves = board.getMoves(board.turn);
+        if (moves.empty()) break;
+
+        oth::Point move = moves[rng() % moves.size()];
+        opening.push_back(move);
+        board.playPiece(board.turn, move.x, move.y, false);
+        board.switchTurn();
+    }
+
+    return opening;
+}
+
+// Latency at fraction of the sorted latencies.
+static double percentile(const std::vector<double>& sorted, double fraction) {
+    if (sorted.empty()) return 0;
+    size_t i = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+static void usage() {
+    std::cerr << "Usage: loadgen [-c levels] [-t workers] [-l seconds] [-d depth] [-b ms] [-h MB] [-s size] [-r plies] [-w weights] [-k book] [-x seed]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> levels = { 1, 10, 100, 1000 };
+    int workers = std::thread::hardware_concurrency();
+    double seconds = 5;
+    int depth = 4;
+    int budget = 60000;
+    size_t hashMegabytes = 64;
+    int size = 8;
+    int randomPlies = 8;
+    unsigned seed = 1;
+    std::string weightsPath, bookPath;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc) {
+                std::string value = argv[++i];
+                switch (arg[1]) {
+                    case 'c': {
+                        levels.clear();
+                        std::istringstream parts(value);
+                        for (std::string part; std::getline(parts, part, ',');) levels.push_back(std::stoi(part));
+                        break;
+                    }
+                    case 't': workers = std::stoi(value); break;
+                    case 'l': seconds = std::stod(value); break;
+                    case 'd': depth = std::stoi(value); break;
+                    case 'b': budget = std::stoi(value); break;
+                    case 'h': hashMegabytes = std::stoul(value); break;
+                    case 's': size = std::stoi(value); break;
+                    case 'r': randomPlies = std::stoi(value); break;
+                    case 'w': weightsPath = value; break;
+                    case 'k': bookPath = value; break;
+                    case 'x': seed = std::stoul(value); break;
+                    default: usage(); return 2;
+                }
+            } else {
+                usage();
+                return 2;
+            }
+        }
+    } catch (const std::exception&) {
+        usage();
+        return 2;
+    }
+    if (workers < 1) workers = 1;
+
+    std::shared_ptr<const oth::PatternEvaluator> evaluator;
+    std::shared_ptr<const oth::OpeningBook> book;
+    try {
+        if (!weightsPath.empty()) evaluator.reset(new oth::PatternEvaluator(oth::PatternEvaluator::load(weightsPath)));
+        if (!bookPath.empty()) book = oth::OpeningBook::open(bookPath);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    // One table for every engine of every level, so it is only allocated once.
+    std::shared_ptr<oth::TranspositionTable> table = std::make_shared<oth::TranspositionTable>(hashMegabytes);
+    oth::GameHost::EngineFactory factory = [table, evaluator, book]() {
+        oth::MinimaxEngine* engine = new oth::MinimaxEngine(0);
+        engine->verbose = false;
+        // The host ages the table, once for all of them.
+        engine->setTable(table, false);
+        engine->setEvaluator(evaluator);
+        engine->setBook(book);
+        return std::unique_ptr<oth::Engine>(engine);
+    };
+
+    oth::GameHost::GameSettings settings;
+    settings.size = size;
+    settings.budget = budget;
+    settings.limits.depth = depth;
+
+    std::mt19937 rng(seed);
+    std::mutex rngLock;
+
+    std::cout << workers << " workers, " << size << "x" << size << ", depth " << depth << ", "
+        << budget << "ms per side, " << seconds << "s per level" << std::endl;
+    std::cout << "  games   moves/s   games/s    p50 ms    p99 ms  lost on time  forfeits" << std::endl;
+
+    for (size_t l = 0; l < levels.size(); l++) {
+        oth::GameHost host(workers, factory, table);
+
+        // Every game that ends starts another, so the level stays the same.
+        // Called by the workers, and here to start the first games.
+        std::function<void(const oth::GameHost::Result&)> replace;
+        replace = [&](const oth::GameHost::Result&) {
+            oth::GameHost::GameSettings next = settings;
+            {
+                std::lock_guard<std::mutex> guard(rngLock);
+                next.opening = randomOpening(size, randomPlies, rng);
+            }
+            host.addGame(next, replace);
+        };
+        oth::GameHost::Result none;
+        for (int g = 0; g < levels[l]; g++) replace(none);
+
+        // The first games of a level all start at once, so the first second is left out.
+        double warmup = seconds > 2 ? 1 : 0;
+        std::this_thread::sleep_for(std::chrono::duration<double>(warmup));
+        host.takeStats();
+        auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds - warmup));
+        oth::GameHost::Stats stats = host.takeStats();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        host.stop();
+
+        std::sort(stats.latencies.begin(), stats.latencies.end());
+        std::cout << std::fixed << std::setw(7) << levels[l]
+            << std::setw(10) << (long long)(stats.moves / elapsed)
+            << std::setw(10) << std::setprecision(1) << stats.games / elapsed
+            << std::setw(10) << std::setprecision(2) << percentile(stats.latencies, 0.5)
+            << std::setw(10) << percentile(stats.latencies, 0.99)
+            << std::setw(14) << stats.timeLosses
+            << std::setw(10) << stats.forfeits << std::endl;
+    }
+
+    return 0;
+}
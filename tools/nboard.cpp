@@ -0,0 +1,491 @@
+#include "othello.h"
+#include "randomengine.cpp"
+#include "minimaxengine.cpp"
+#include "evaluator.h"
+#include "book.h"
+#include "probcut.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+/*
+    The minimax engine as a long running process, speaking the NBoard protocol
+    on the standard input and output, so GUIs and match managers can drive it.
+
+    The engine, its table and the weights are made once, and kept between moves
+    and games, so a search starts with everything the earlier ones stored.
+
+    Usage: nboard [options]
+        -w <file>     pattern weights (patterns.bin if there is one)
+        -b <file>     opening book (book.bin if there is one)
+        -c <file>     Multi-ProbCut parameters (probcut.bin if there is one)
+        -h <MB>       transposition table (64)
+        -t <threads>  threads searching every move (1)
+
+    Commands, one per line:
+        nboard <version>    answered with "set myname <name>"
+        set game <ggf>      the game so far, as a GGF game with its BO board and moves
+        set depth <plies>   search every move to this depth
+        set movetime <ms>   search every move this long instead (not in NBoard)
+        move <move>         play a move like F5, or PA to pass, with anything after a /
+        go [ms]             search the side to move, answered with "=== <move>/<eval>/<seconds>"
+        hint <count>        search every move, answered with "search <move> <eval> 0 <depth>"
+                            for the best count moves, deeper and deeper until the limit
+        stop                stop the running search, which answers with what it has (not in NBoard)
+        ping <n>            answered with "pong <n>" once nothing is running
+        learn               answered with "learned"
+        quit
+
+    Searches run in the background, so commands are read while they think. Any
+    command stops a running hint. A running go is always answered: other commands
+    wait for it, and stop makes it answer at once. Evals are in discs, for the
+    side to move. A "status" line is sent when a search starts, and an empty one
+    when it ends. Bad commands are reported on the standard error.
+*/
+
+class NBoardSession {
+    oth::MinimaxEngine& engine;
+    std::shared_ptr<const oth::PatternEvaluator> evaluator;
+    std::ostream& out;
+    std::mutex outLock;
+
+    oth::RandomEngine random;
+    std::unique_ptr<oth::Othello> board;
+
+    oth::SearchLimits limits;
+
+    // The running search, and the flag that stops it.
+    std::thread searcher;
+    std::atomic<bool> cancelled;
+
+    // Whether the next command stops the running search, which only hints do.
+    // A move asked with go is always answered, unless it is stopped.
+    bool superseded = false;
+
+    void send(const std::string& line) {
+        std::lock_guard<std::mutex> lock(outLock);
+        out << line << '\n';
+        out.flush();
+    }
+
+    static std::string name(const oth::Point& move) {
+        if (move.x < 0) return "PA";
+        return std::string(1, 'A' + move.x) + std::to_string(move.y + 1);
+    }
+
+    // Reads a move like F5 or f5, with anything after a / left out.
+    // A pass is (-1, -1). Returns false if it is not a move of the board.
+    bool parseMove(const std::string& text, oth::Point& move) {
+        std::string token = text.substr(0, text.find('/'));
+        for (size_t i = 0; i < token.size(); i++) token[i] = std::toupper((unsigned char)token[i]);
+        if (token == "PA" || token == "PASS") {
+            move = oth::Point(-1, -1);
+            return true;
+        }
+        if (token.size() < 2 || token[0] < 'A' || !std::isdigit((unsigned char)token[1])) return false;
+
+        int x = token[0] - 'A';
+        int y = std::atoi(token.c_str() + 1) - 1;
+        if (x >= board->size || y < 0 || y >= board->size) return false;
+        move = oth::Point(x, y);
+        return true;
+    }
+
+    // Plays a move of the side to move. A side without moves passes first, for
+    // games that leave their passes out. Returns false if the move is not legal.
+    bool play(const oth::Point& move) {
+        if (move.x < 0) {
+            board->switchTurn();
+            return true;
+        }
+        if (!board->getMoves(board->turn).contains(move) && board->getMoves(board->turn).empty()) board->switchTurn();
+        if (!board->getMoves(board->turn).contains(move)) return false;
+
+        board->playPiece(board->turn, move.x, move.y, true);
+        board->switchTurn();
+        return true;
+    }
+
+    // Sets the board from a GGF game: its BO board, then its B and W moves.
+    // Returns false with the reason in error if the game can't be played.
+    bool setGame(const std::string& ggf, std::string& error) {
+        std::vector<std::pair<std::string, std::string>> tags;
+        for (size_t i = 0; i < ggf.size(); i++) {
+            if (!std::isupper((unsigned char)ggf[i])) continue;
+            size_t start = i;
+            while (i < ggf.size() && std::isupper((unsigned char)ggf[i])) i++;
+            if (i >= ggf.size() || ggf[i] != '[') continue;
+            size_t end = ggf.find(']', i);
+            if (end == std::string::npos) break;
+            tags.push_back(std::make_pair(ggf.substr(start, i - start), ggf.substr(i + 1, end - i - 1)));
+            i = end;
+        }
+
+        bool hasBoard = false;
+        for (size_t t = 0; t < tags.size() && !hasBoard; t++) {
+            if (tags[t].first != "BO") continue;
+            std::istringstream in(tags[t].second);
+            int size;
+            std::string squares, part;
+            if (!(in >> size) || size < 4 || size > oth::Othello::MAXSIZE) {
+                error = "bad board size";
+                return false;
+            }
+            while (in >> part) squares += part;
+            if ((int)squares.size() != size * size + 1) {
+                error = "the board has " + std::to_string(squares.size()) + " squares and sides";
+                return false;
+            }
+
+            std::string cells(size * size, '-');
+            for (int i = 0; i < size * size; i++) {
+                char c = squares[i];
+                if (c == '*' || c == 'X' || c == 'x') cells[i] = 'X';
+                else if (c == 'O' || c == 'o') cells[i] = 'O';
+            }
+            char side = squares.back();
+            oth::Color turn = side == 'O' || side == 'o' ? oth::white : oth::black;
+
+            // Boards are kept, and only made again when the size changes.
+            if (!board || board->size != size) board.reset(new oth::Othello(size, random, random));
+            try {
+                board->setPosition(cells, turn);
+            } catch (const std::invalid_argument& e) {
+                error = e.what();
+                return false;
+            }
+            hasBoard = true;
+        }
+        if (!hasBoard) {
+            error = "no BO board";
+            return false;
+        }
+
+        for (size_t t = 0; t < tags.size(); t++) {
+            if (tags[t].first != "B" && tags[t].first != "W") continue;
+            oth::Point move;
+            if (!parseMove(tags[t].second, move) || !play(move)) {
+                error = "illegal move " + tags[t].second;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Search scores are in 1/16 discs with pattern weights.
+    double discs(int score) {
+        return evaluator && evaluator->size() == board->size ? score / (double)oth::PatternEvaluator::SCALE : score;
+    }
+
+    static std::string number(double value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.2f", value);
+        return buffer;
+    }
+
+    // Starts a search in the background. Only one runs at a time.
+    template<typename Search>
+    void start(Search search, bool hint) {
+        cancel();
+        superseded = hint;
+        cancelled = false;
+        send("status thinking");
+        searcher = std::thread([this, search]() {
+            search();
+            send("status");
+        });
+    }
+
+    // Finds the move of the side to move with the limits, and sends it.
+    void go(const oth::SearchLimits& limits) {
+        if (board->getMoves(board->turn).empty()) {
+            send("=== PA");
+            return;
+        }
+
+        oth::SearchRequest request;
+        request.limits = limits;
+        request.cancel = &cancelled;
+        oth::SearchResult result = engine.searchMove(*board, request);
+        double seconds = result.milliseconds / 1000;
+
+        send("nodestats " + std::to_string(result.nodes) + " " + number(seconds));
+        send("=== " + name(result.move) + "/" + number(discs(result.score)) + "/" + number(seconds));
+    }
+
+    // Score for the side to move of playing move on board, searched to depth after it
+    // with the time left. pv gets the move and its best line, and fromBook whether
+    // the score came from the book, without a search.
+    int scoreAfter(const oth::Point& move, int depth, int moveTime, std::string& pv, bool& fromBook) {
+        oth::Color color = board->turn;
+        board->playPiece(color, move.x, move.y, true);
+        board->switchTurn();
+        pv = name(move);
+
+        oth::SearchRequest request;
+        request.limits.depth = depth;
+        request.limits.moveTime = moveTime;
+        request.cancel = &cancelled;
+
+        int score;
+        int sign = -1;
+        fromBook = false;
+        if (board->getMoves(board->turn).empty()) {
+            // The opponent passes, so the side that moved searches again.
+            board->switchTurn();
+            pv += "PA";
+            sign = 1;
+        }
+        if (!board->getMoves(board->turn).empty()) {
+            score = sign * engine.searchMove(*board, request).score;
+            const oth::SearchStats& stats = engine.getStats();
+            fromBook = stats.fromBook;
+            for (size_t i = stats.iterations.size(); i-- > 0;) {
+                if (!stats.iterations[i].completed) continue;
+                for (size_t j = 0; j < stats.iterations[i].pv.size(); j++) pv += name(stats.iterations[i].pv[j]);
+                break;
+            }
+        } else {
+            oth::Color opp = color == oth::white ? oth::black : oth::white;
+            score = board->getScore(color) - board->getScore(opp);
+            if (evaluator && evaluator->size() == board->size) score *= oth::PatternEvaluator::SCALE;
+        }
+        if (sign > 0) board->switchTurn();
+
+        board->undoMove();
+        return score;
+    }
+
+    // Scores every move deeper and deeper, and sends the best count after every depth.
+    void hint(int count, const oth::SearchLimits& limits) {
+        std::vector<oth::Point> moves;
+        const oth::MoveList& list = board->getMoves(board->turn);
+        for (int i = 0; i < list.size(); i++) moves.push_back(list[i]);
+        if (moves.empty()) return;
+
+        auto startTime = std::chrono::steady_clock::now();
+        // Milliseconds left of the movetime, or 0 without one.
+        auto timeLeft = [&]() {
+            if (limits.moveTime <= 0) return 0;
+            int elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+            return limits.moveTime - elapsed;
+        };
+
+        int maxDepth = limits.depth > 0 ? limits.depth : MAXDEPTH;
+        bool timeUp = false;
+        for (int depth = 2; depth <= maxDepth && !cancelled; depth++) {
+            std::vector<std::pair<int, std::string>> scored;
+            bool allFromBook = true;
+            for (size_t i = 0; i < moves.size() && !cancelled; i++) {
+                // Every search has its own clock, so each move gets its share of
+                // what is left, and the hint ends on time.
+                int moveTime = 0;
+                if (limits.moveTime > 0) {
+                    int left = timeLeft();
+                    if (left <= 0) {
+                        timeUp = true;
+                        break;
+                    }
+                    moveTime = std::max(1, left / (int)(moves.size() - i));
+                }
+
+                std::string pv;
+                bool fromBook;
+                int score = scoreAfter(moves[i], depth - 1, moveTime, pv, fromBook);
+                scored.push_back(std::make_pair(score, pv));
+                allFromBook = allFromBook && fromBook;
+            }
+
+            // A depth cut short by time or a stop has scores of other depths, so it is not sent.
+            timeUp = timeUp || (limits.moveTime > 0 && timeLeft() <= 0);
+            if (cancelled || (timeUp && (depth > 2 || scored.size() < moves.size()))) break;
+
+            std::stable_sort(scored.begin(), scored.end(), [](const std::pair<int, std::string>& a, const std::pair<int, std::string>& b) {
+                return a.first > b.first;
+            });
+            for (int i = 0; i < count && i < (int)scored.size(); i++) {
+                send("search " + scored[i].second + " " + number(discs(scored[i].first)) + " 0 " + std::to_string(depth));
+            }
+            // Book scores don't get deeper.
+            if (timeUp || allFromBook) break;
+
+            // Every line reached the end of the game, so deeper searches give the same scores.
+            int empties = board->size * board->size - board->getScore(oth::white) - board->getScore(oth::black);
+            if (depth > empties * 2) break;
+        }
+    }
+
+public:
+
+    // engine and evaluator are kept by the caller, and evaluator is the one the engine
+    // uses, to give evals in discs.
+    NBoardSession(oth::MinimaxEngine& engine, std::shared_ptr<const oth::PatternEvaluator> evaluator, std::ostream& out) :
+            engine(engine), evaluator(evaluator), out(out), cancelled(false) {
+        engine.verbose = false;
+        limits.moveTime = 1000;
+        board.reset(new oth::Othello(8, random, random));
+    }
+
+    ~NBoardSession() {
+        cancel();
+    }
+
+    // Stops the running search, and waits for it to end.
+    void cancel() {
+        if (!searcher.joinable()) return;
+        cancelled = true;
+        searcher.join();
+    }
+
+    // Waits for the running search to end by itself.
+    void finish() {
+        if (searcher.joinable()) searcher.join();
+    }
+
+    // Runs one command. Returns false on quit.
+    bool command(const std::string& line) {
+        std::istringstream in(line);
+        std::string word;
+        if (!(in >> word)) return true;
+
+        if (word == "stop" || word == "quit" || superseded) cancel();
+        else finish();
+
+        if (word == "quit") return false;
+
+        if (word == "nboard") {
+            send("set myname othello-minimax");
+        } else if (word == "set") {
+            std::string what;
+            in >> what;
+            if (what == "game") {
+                std::string ggf, error;
+                std::getline(in, ggf);
+                if (!setGame(ggf, error)) std::cerr << "Bad game: " << error << std::endl;
+            } else if (what == "depth" || what == "movetime") {
+                int value;
+                if (!(in >> value) || value < 1) {
+                    std::cerr << "Bad " << what << std::endl;
+                    return true;
+                }
+                limits = oth::SearchLimits();
+                if (what == "depth") limits.depth = value;
+                else limits.moveTime = value;
+            }
+            // Other settings, like contempt, are not used.
+        } else if (word == "move") {
+            std::string text;
+            oth::Point move;
+            if (!(in >> text) || !parseMove(text, move) || !play(move)) std::cerr << "Illegal move: " << text << std::endl;
+        } else if (word == "go") {
+            oth::SearchLimits searched = limits;
+            int moveTime;
+            if (in >> moveTime && moveTime > 0) {
+                searched = oth::SearchLimits();
+                searched.moveTime = moveTime;
+            }
+            start([this, searched]() { go(searched); }, false);
+        } else if (word == "hint") {
+            int count = 1;
+            in >> count;
+            oth::SearchLimits searched = limits;
+            start([this, count, searched]() { hint(count, searched); }, true);
+        } else if (word == "ping") {
+            std::string n;
+            in >> n;
+            send("pong " + n);
+        } else if (word == "learn") {
+            send("learned");
+        } else if (word != "stop" && word != "analyze") {
+            std::cerr << "Unknown command: " << word << std::endl;
+        }
+        return true;
+    }
+
+    // Runs the commands of in, until quit or the end of the input.
+    void run(std::istream& in) {
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!command(line)) break;
+        }
+        cancel();
+    }
+};
+
+static void usage() {
+    std::cerr << "Usage: nboard [-w weights] [-b book] [-c probcut] [-h MB] [-t threads]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::string weightsPath = "patterns.bin";
+    std::string bookPath = "book.bin";
+    std::string probCutPath = "probcut.bin";
+    size_t hashMegabytes = 64;
+    int threads = 1;
+    // Files given by name have to be there. The default ones are used if they are.
+    bool given[3] = {};
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc) {
+            std::string value = argv[++i];
+            switch (arg[1]) {
+                case 'w': weightsPath = value; given[0] = true; break;
+                case 'b': bookPath = value; given[1] = true; break;
+                case 'c': probCutPath = value; given[2] = true; break;
+                case 'h': hashMegabytes = std::stoul(value); break;
+                case 't': threads = std::stoi(value); break;
+                default: usage(); return 2;
+            }
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    oth::MinimaxEngine engine(hashMegabytes);
+    engine.setThreads(threads);
+
+    std::shared_ptr<const oth::PatternEvaluator> evaluator;
+    try {
+        evaluator.reset(new oth::PatternEvaluator(oth::PatternEvaluator::load(weightsPath)));
+    } catch (const std::runtime_error& e) {
+        if (given[0]) {
+            std::cerr << e.what() << std::endl;
+            return 2;
+        }
+    }
+    engine.setEvaluator(evaluator);
+
+    try {
+        engine.setBook(oth::OpeningBook::open(bookPath));
+    } catch (const std::runtime_error& e) {
+        if (given[1]) {
+            std::cerr << e.what() << std::endl;
+            return 2;
+        }
+    }
+
+    try {
+        engine.setProbCut(std::make_shared<oth::ProbCut>(oth::ProbCut::load(probCutPath)));
+    } catch (const std::runtime_error& e) {
+        if (given[2]) {
+            std::cerr << e.what() << std::endl;
+            return 2;
+        }
+    }
+
+    NBoardSession session(engine, evaluator, std::cout);
+    session.run(std::cin);
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include "othello.h"
+#include "randomengine.cpp"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+
+/*
+    Counts the leaves of the move tree to a fixed depth, to check and time
+    move generation, playPiece and undoMove on their own.
+
+    A pass is a ply. When both sides have to pass the game is over, and the
+    position counts as one leaf even if the depth is not reached.
+
+    Usage: perft [depth] [positions file]
+
+    Without a file, the start position is counted to every depth up to depth,
+    then the built in positions are counted. Every line of a positions file is
+    "<cells> <X|O> <depth> [leaves]", with cells as in Othello::setPosition.
+    Lines starting with # are skipped. The board size is taken from the cells.
+*/
+
+struct PerftPosition {
+    std::string name;
+    std::string cells;
+    oth::Color turn;
+    int depth;
+    // -1 if the count is not known.
+    long long leaves;
+};
+
+// Leaves of the standard 8x8 start position, by depth.
+static const long long startLeaves[] = {
+    1, 4, 12, 56, 244, 1396, 8200, 55092, 390216, 3005288, 24571284, 212258800, 1939886636
+};
+static const int startKnown = sizeof(startLeaves) / sizeof(startLeaves[0]) - 1;
+
+// Positions reached by random games. Their counts agree between the bitboard and the cell matrix.
+static const PerftPosition builtinPositions[] = {
+    { "midgame, 20 plies",
+      "----------X------OX--X--O-OOXO---O-XO-----OOOO-----OXO----X-OOOO", oth::black, 6, 1868906 },
+    { "midgame, 30 plies",
+      "---O--------OOOO---OOOO----OXXXX-XOXOXX--OXOXXOOOXXXX------X-O--", oth::black, 6, 2635151 },
+    { "white has to pass",
+      "XXOO----OOOOOOO-OOOOXOO-OOOOXOOOOOOXXOO-OOOOXOOO-OXXXOO--OOOOO-O", oth::white, 8, 15529 },
+    { "endgame, 18 empties",
+      "-OOOX--XXOOXX--XOOXXXXOXOOOXXOO-XXXXOOO--XXOXO--XXXOOO----XOOOOO", oth::black, 8, 1555551 },
+};
+
+static long long perft(oth::Othello& board, int depth, bool passed) {
+    if (depth == 0) return 1;
+
+    const oth::MoveList& moves = board.getMoves(board.turn);
+
+    if (moves.empty()) {
+        // Two passes in a row end the game.
+        if (passed) return 1;
+
+        board.switchTurn();
+        long long leaves = perft(board, depth - 1, true);
+        board.switchTurn();
+        return leaves;
+    }
+
+    // The list changes while searching, so the moves are copied first.
+    oth::MoveList list = moves;
+
+    long long leaves = 0;
+    for (int i = 0; i < list.size(); i++) {
+        board.playPiece(board.turn, list[i].x, list[i].y, true);
+        board.switchTurn();
+        leaves += perft(board, depth - 1, false);
+        board.undoMove();
+    }
+
+    return leaves;
+}
+
+// Counts one position, and prints a line of the result table.
+// Returns false if the count is known and different.
+static bool run(oth::Othello& board, const std::string& name, int depth, long long expected) {
+    auto start = std::chrono::steady_clock::now();
+    long long leaves = perft(board, depth, false);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool ok = expected < 0 || leaves == expected;
+
+    std::cout << std::left << std::setw(22) << name << std::right
+        << std::setw(6) << depth
+        << std::setw(14) << leaves
+        << std::setw(12) << std::fixed << std::setprecision(1) << seconds * 1000
+        << std::setw(14) << std::setprecision(0) << (seconds > 0 ? leaves / seconds : 0)
+        << "  " << (expected < 0 ? "-" : ok ? "ok" : "FAIL (expected " + std::to_string(expected) + ")")
+        << std::endl;
+
+    return ok;
+}
+
+static int boardSize(const std::string& cells) {
+    int size = 0;
+    while (size * size < (int)cells.size()) size++;
+    return size;
+}
+
+int main(int argc, char** argv) {
+    int depth = argc > 1 ? std::stoi(argv[1]) : 9;
+
+    oth::RandomEngine engine;
+    bool ok = true;
+
+#ifdef OTH_NO_BITBOARD
+    std::cout << "Cell matrix" << std::endl;
+#else
+    std::cout << "Bitboard on 8x8, wide bitboard from 9x9 to 16x16, cell matrix on other sizes" << std::endl;
+#endif
+    std::cout << "position               depth        leaves    time(ms)       leaves/s  check" << std::endl;
+
+    std::vector<PerftPosition> positions;
+
+    if (argc > 2) {
+        std::ifstream file(argv[2]);
+        if (!file) {
+            std::cerr << "Can't open " << argv[2] << std::endl;
+            return 2;
+        }
+
+        std::string line;
+        for (int number = 1; std::getline(file, line); number++) {
+            if (line.empty() || line[0] == '#') continue;
+
+            std::istringstream in(line);
+            PerftPosition position;
+            std::string side;
+            position.leaves = -1;
+            if (!(in >> position.cells >> side >> position.depth) || (side != "X" && side != "O")) {
+                std::cerr << "Line " << number << ": expected <cells> <X|O> <depth> [leaves]" << std::endl;
+                return 2;
+            }
+            in >> position.leaves;
+
+            position.name = "line " + std::to_string(number);
+            position.turn = side == "X" ? oth::black : oth::white;
+            positions.push_back(position);
+        }
+    } else {
+        // The start position to every depth, so the speed of each depth shows.
+        oth::Othello board(8, engine, engine);
+        for (int d = 1; d <= depth; d++) {
+            ok &= run(board, "start", d, d <= startKnown ? startLeaves[d] : -1);
+        }
+
+        positions.assign(std::begin(builtinPositions), std::end(builtinPositions));
+    }
+
+    for (size_t i = 0; i < positions.size(); i++) {
+        try {
+            oth::Othello board(boardSize(positions[i].cells), engine, engine);
+            board.setPosition(positions[i].cells, positions[i].turn);
+            ok &= run(board, positions[i].name, positions[i].depth, positions[i].leaves);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << positions[i].name << ": " << e.what() << std::endl;
+            return 2;
+        }
+    }
+
+    if (!ok) std::cout << "Some counts are wrong" << std::endl;
+    return ok ? 0 : 1;
+}
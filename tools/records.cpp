@@ -0,0 +1,158 @@
+#include "othello.h"
+#include "randomengine.cpp"
+#include "gamerecord.h"
+#include <iostream>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <ctime>
+#include <cstdlib>
+
+/*
+    Lists and replays the games of an archive, as written by the game and by
+    tools/tournament -a.
+
+    Usage: records [options] <archive>
+        -v            replay every game and check it, instead of listing
+        -r <times>    replay the archive this many times, to measure the speed (1)
+        -g <game>     show the moves of one game, counted from 1
+
+    A listed game is one line: "<game> <size> <black> <white> <discs> <ms> <moves>",
+    with discs like 36-28, black first, and ms the length of the game.
+
+    A replayed game plays its moves with Othello::playPiece from its start
+    position. It is bad if a move is not legal, or the final discs are not
+    the ones in the record. Bad games are written to the standard error, and
+    the speed at the end.
+*/
+
+// Counts the passes of a replayed game, so they are shown like moves.
+class PassCounter : public oth::GameObserver {
+public:
+    int passes = 0;
+
+    void gameStarted(oth::Othello& board) { passes = 0; }
+    void passed(oth::Othello& board, oth::Color color) { passes++; }
+};
+
+static std::string name(const oth::Point& move) {
+    return std::string(1, 'a' + move.x) + std::to_string(move.y + 1);
+}
+
+static void usage() {
+    std::cerr << "Usage: records [-v] [-r times] [-g game] <archive>" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    bool verify = false;
+    int times = 1;
+    long long shown = 0;
+    std::string path;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-v") {
+            verify = true;
+        } else if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc) {
+            std::string value = argv[++i];
+            switch (arg[1]) {
+                case 'r': times = std::stoi(value); verify = true; break;
+                case 'g': shown = std::stoll(value); break;
+                default: usage(); return 2;
+            }
+        } else {
+            path = arg;
+        }
+    }
+
+    if (path.empty()) {
+        usage();
+        return 2;
+    }
+
+    std::unique_ptr<oth::GameReader> reader;
+    try {
+        reader.reset(new oth::GameReader(path));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    oth::GameRecord record;
+    oth::RandomEngine random;
+
+    try {
+        if (shown > 0) {
+            for (long long game = 1; reader->next(record); game++) {
+                if (game < shown) continue;
+
+                std::time_t started = (std::time_t)record.startTime;
+                char when[32];
+                std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", std::localtime(&started));
+                std::cout << "Game " << game << " on " << record.size << "x" << record.size << ", " << when << std::endl;
+                std::cout << "Black " << record.blackName << ", " << record.blackDiscs << " discs, thought " << record.blackMilliseconds << "ms" << std::endl;
+                std::cout << "White " << record.whiteName << ", " << record.whiteDiscs << " discs, thought " << record.whiteMilliseconds << "ms" << std::endl;
+                std::cout << (record.firstTurn == oth::black ? "Black" : "White") << " moves first"
+                    << (record.start.empty() ? "" : " from " + record.start) << std::endl;
+                for (size_t i = 0; i < record.moves.size(); i++) std::cout << name(record.moves[i]);
+                std::cout << std::endl;
+                return 0;
+            }
+            std::cerr << path << " has no game " << shown << std::endl;
+            return 1;
+        }
+
+        if (!verify) {
+            for (long long game = 1; reader->next(record); game++) {
+                std::cout << game << " " << record.size << " " << record.blackName << " " << record.whiteName << " "
+                    << record.blackDiscs << "-" << record.whiteDiscs << " " << record.milliseconds << " " << record.moves.size() << std::endl;
+            }
+            return 0;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    // Boards are kept, and only made again when the size changes.
+    std::unique_ptr<oth::Othello> board;
+    PassCounter counter;
+    long long games = 0, moves = 0, bad = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < times; pass++) {
+        reader->rewind();
+        long long game = 1;
+        try {
+            for (; reader->next(record); game++) {
+                if (!board || board->size != record.size) board.reset(new oth::Othello(record.size, random, random));
+
+                bool ok = true;
+                try {
+                    record.replay(*board, counter);
+                    ok = board->getScore(oth::black) == record.blackDiscs && board->getScore(oth::white) == record.whiteDiscs;
+                    if (!ok && pass == 0) std::cerr << "Game " << game << " ends with other discs than its record" << std::endl;
+                } catch (const std::runtime_error& e) {
+                    ok = false;
+                    if (pass == 0) std::cerr << "Game " << game << ": " << e.what() << std::endl;
+                }
+
+                games++;
+                moves += record.moves.size() + counter.passes;
+                if (!ok && pass == 0) bad++;
+            }
+        } catch (const std::exception& e) {
+            // A broken record hides every game after it.
+            std::cerr << "Game " << game << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << games / times << " games (" << bad << " bad), " << reader->size() << " bytes, replayed "
+        << times << (times == 1 ? " time" : " times") << " in " << seconds << "s, "
+        << (long long)(seconds > 0 ? games / seconds : 0) << " games/s, "
+        << (long long)(seconds > 0 ? moves / seconds : 0) << " moves/s" << std::endl;
+
+    return bad > 0 ? 1 : 0;
+}
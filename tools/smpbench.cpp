@@ -0,0 +1,130 @@
+#include "othello.h"
+#include "minimaxengine.cpp"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/*
+    Measures how the parallel search scales with the number of threads.
+    Every thread count searches the same positions to the same depth,
+    and the time to reach that depth is compared with one thread.
+
+    Heap allocations are counted too. Make/unmake doesn't allocate, so the
+    count per million nodes only comes from starting the helper threads
+    and from the statistics kept for every move.
+
+    Usage: smpbench [max threads] [depth]
+*/
+
+// Every heap allocation of the program.
+static std::atomic<long long> allocations(0);
+
+// Every form of new and delete counts and frees here, so they all match. These
+// are kept out of line, or GCC sees the malloc and free through them, pairs
+// them with the other form, and warns of a mismatch.
+__attribute__((noinline)) static void* allocate(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) static void release(void* p) noexcept { free(p); }
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+
+// Plays random moves from the start, to get a reproducible set of positions.
+static std::vector<std::vector<oth::Point>> makePositions(oth::Engine& engine, int count, int plies) {
+    std::mt19937 rng(20240101);
+    std::vector<std::vector<oth::Point>> positions;
+
+    while ((int)positions.size() < count) {
+        oth::Othello board(8, engine, engine);
+        std::vector<oth::Point> line;
+
+        for (int i = 0; i < plies; i++) {
+            const oth::MoveList& moves = board.getMoves(board.turn);
+            if (moves.empty()) break;
+
+            oth::Point move = moves[rng() % moves.size()];
+            line.push_back(move);
+            board.playPiece(board.turn, move.x, move.y, false);
+            board.switchTurn();
+        }
+
+        // Only keep positions where the side to move can play.
+        if ((int)line.size() == plies && !board.getMoves(board.turn).empty()) positions.push_back(line);
+    }
+
+    return positions;
+}
+
+int main(int argc, char** argv) {
+    int maxThreads = argc > 1 ? std::stoi(argv[1]) : std::thread::hardware_concurrency();
+    int depth = argc > 2 ? std::stoi(argv[2]) : 10;
+    if (maxThreads < 1) maxThreads = 1;
+
+    oth::MinimaxEngine engine(64);
+    engine.verbose = false;
+
+    oth::SearchLimits limits;
+    limits.depth = depth;
+    engine.setLimits(limits);
+
+    std::vector<std::vector<oth::Point>> positions = makePositions(engine, 8, 20);
+
+    std::cout << "Depth " << depth << ", " << positions.size() << " positions" << std::endl;
+    std::cout << "threads     time(ms)      nodes/s   speedup  allocs/Mnode" << std::endl;
+
+    double baseTime = 0;
+    for (int threads = 1; threads <= maxThreads;) {
+        engine.setThreads(threads);
+
+        double seconds = 0;
+        long long nodes = 0;
+        long long allocated = 0;
+        for (size_t i = 0; i < positions.size(); i++) {
+            // Every position starts with an empty table, so runs don't help each other.
+            engine.getTable().clear();
+
+            oth::Othello board(8, engine, engine);
+            for (size_t j = 0; j < positions[i].size(); j++) {
+                board.playPiece(board.turn, positions[i][j].x, positions[i][j].y, false);
+                board.switchTurn();
+            }
+
+            long long allocStart = allocations;
+            auto start = std::chrono::steady_clock::now();
+            engine.nextMove(board);
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            allocated += allocations - allocStart;
+            nodes += engine.getMovesForeseen();
+        }
+
+        if (threads == 1) baseTime = seconds;
+
+        std::cout << std::setw(7) << threads
+            << std::setw(13) << std::fixed << std::setprecision(1) << seconds * 1000
+            << std::setw(13) << std::setprecision(0) << nodes / seconds
+            << std::setw(10) << std::setprecision(2) << baseTime / seconds
+            << std::setw(14) << std::setprecision(1) << allocated * 1e6 / nodes << std::endl;
+
+        // Double every run, but always end with the requested count.
+        if (threads == maxThreads) break;
+        threads = threads * 2 > maxThreads ? maxThreads : threads * 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+#include "othello.h"
+#include "randomengine.cpp"
+#include "minimaxengine.cpp"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+
+/*
+    Solves 8x8 endgames with the exact solver of MinimaxEngine, and prints the
+    final disc difference, the best move and the speed of every position.
+
+    With -c, every position is also searched to the end by the plain search with
+    the solver turned off, and the scores must be the same. The plain search is
+    much slower, so only check positions with few empties.
+
+    Usage: solve [options] [positions file]
+        -e <empties>    empties of the random positions (20)
+        -n <positions>  number of random positions (5)
+        -x <seed>       seed of the random positions (1)
+        -c              check the scores with the plain search
+
+    Without a file, positions come from random games stopped at the empties.
+    Every line of a positions file is "<cells> <X|O>", with cells as in
+    Othello::setPosition. Lines starting with # are skipped.
+*/
+
+struct Position {
+    std::string cells;
+    oth::Color turn;
+};
+
+// Plays random moves until empties are left with a move to play.
+// Returns false if the game ended before.
+static bool randomPosition(std::mt19937& rng, int empties, Position& position) {
+    oth::RandomEngine engine;
+    oth::Othello board(8, engine, engine);
+
+    bool passed = false;
+    while (64 - board.getScore(oth::black) - board.getScore(oth::white) > empties) {
+        const oth::MoveList& moves = board.getMoves(board.turn);
+        if (moves.empty()) {
+            if (passed) return false;
+            passed = true;
+            board.switchTurn();
+            continue;
+        }
+        passed = false;
+
+        oth::Point move = moves[rng() % moves.size()];
+        board.playPiece(board.turn, move.x, move.y, false);
+        board.switchTurn();
+    }
+
+    if (board.getMoves(board.turn).empty()) return false;
+
+    position.cells.clear();
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            oth::Color c = board.at(x, y);
+            position.cells += c == oth::black ? 'X' : c == oth::white ? 'O' : '-';
+        }
+    }
+    position.turn = board.turn;
+    return true;
+}
+
+// Searches the position to the end with the solver on or off, and returns the score.
+static int search(const Position& position, bool solver, oth::Point& move, long long& nodes, double& milliseconds) {
+    oth::RandomEngine random;
+    oth::Othello board(8, random, random);
+    board.setPosition(position.cells, position.turn);
+
+    // No limits, so the search only stops at the end of the game.
+    oth::MinimaxEngine engine(64);
+    engine.verbose = false;
+    engine.setLimits(oth::SearchLimits());
+    engine.setEndgameEmpties(solver ? 64 : 0);
+
+    move = engine.nextMove(board);
+    nodes = engine.getStats().nodes;
+    milliseconds = engine.getStats().milliseconds;
+    return engine.getStats().score;
+}
+
+static std::string name(const oth::Point& move) {
+    return std::string(1, 'a' + move.x) + std::to_string(move.y + 1);
+}
+
+static void usage() {
+    std::cerr << "Usage: solve [-e empties] [-n positions] [-x seed] [-c] [positions file]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int empties = 20;
+    int count = 5;
+    unsigned seed = 1;
+    bool check = false;
+    std::string path;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-c") {
+            check = true;
+        } else if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc) {
+            std::string value = argv[++i];
+            switch (arg[1]) {
+                case 'e': empties = std::stoi(value); break;
+                case 'n': count = std::stoi(value); break;
+                case 'x': seed = std::stoul(value); break;
+                default: usage(); return 2;
+            }
+        } else if (arg[0] != '-') {
+            path = arg;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    std::vector<Position> positions;
+    if (!path.empty()) {
+        std::ifstream file(path);
+        if (!file) {
+            std::cerr << "Can't open " << path << std::endl;
+            return 2;
+        }
+
+        std::string line;
+        for (int number = 1; std::getline(file, line); number++) {
+            if (line.empty() || line[0] == '#') continue;
+
+            std::istringstream in(line);
+            Position position;
+            std::string side;
+            if (!(in >> position.cells >> side) || position.cells.size() != 64 || (side != "X" && side != "O")) {
+                std::cerr << "Line " << number << ": expected <cells> <X|O> of an 8x8 board" << std::endl;
+                return 2;
+            }
+            position.turn = side == "X" ? oth::black : oth::white;
+            positions.push_back(position);
+        }
+    } else {
+        std::mt19937 rng(seed);
+        while ((int)positions.size() < count) {
+            Position position;
+            if (randomPosition(rng, empties, position)) positions.push_back(position);
+        }
+    }
+
+    std::cout << "empties  score  move         nodes    time(ms)       nodes/s  check" << std::endl;
+
+    bool ok = true;
+    double totalMilliseconds = 0;
+    for (size_t i = 0; i < positions.size(); i++) {
+        const Position& position = positions[i];
+        int left = 0;
+        for (size_t c = 0; c < position.cells.size(); c++) left += position.cells[c] == '-' || position.cells[c] == '.';
+
+        oth::Point move;
+        long long nodes;
+        double milliseconds;
+        int score;
+        try {
+            score = search(position, true, move, nodes, milliseconds);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << "Position " << i + 1 << ": " << e.what() << std::endl;
+            return 2;
+        }
+        totalMilliseconds += milliseconds;
+
+        std::string result = "-";
+        if (check) {
+            oth::Point plainMove;
+            long long plainNodes;
+            double plainMilliseconds;
+            int plain = search(position, false, plainMove, plainNodes, plainMilliseconds);
+            if (plain == score) result = "ok";
+            else {
+                result = "FAIL (plain search " + std::to_string(plain) + ")";
+                ok = false;
+            }
+        }
+
+        std::cout << std::setw(7) << left
+            << std::setw(7) << score
+            << std::setw(6) << name(move)
+            << std::setw(14) << nodes
+            << std::setw(12) << std::fixed << std::setprecision(1) << milliseconds
+            << std::setw(14) << std::setprecision(0) << (milliseconds > 0 ? nodes * 1000 / milliseconds : 0)
+            << "  " << result << std::endl;
+    }
+
+    std::cout << "Average " << std::fixed << std::setprecision(1)
+        << (positions.empty() ? 0 : totalMilliseconds / positions.size()) << " ms per position" << std::endl;
+
+    if (!ok) std::cout << "Some scores are wrong" << std::endl;
+    return ok ? 0 : 1;
+}
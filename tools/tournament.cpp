@@ -0,0 +1,462 @@
+#include "othello.h"
+#include "randomengine.cpp"
+#include "minimaxengine.cpp"
+#include "evaluator.h"
+#include "logobserver.cpp"
+#include "gamerecord.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <stdexcept>
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+
+/*
+    Plays many games between two engines, without drawing anything.
+    Games are spread over a pool of threads, and every thread makes its own
+    engines, so no engine is shared between games running at the same time.
+
+    Every opening is played twice with the colors swapped, so neither engine
+    gets the better side of an opening more often. Openings are random moves
+    from the start, or lines of a book file like "f5d6c3d3c4", one per line.
+
+    Engines are given as a name with options after colons:
+        random
+        minimax             one second per move
+        minimax:100         100 milliseconds per move
+        minimax:d6          depth 6
+        minimax:n50000      50000 nodes
+        minimax:d6:w=file   depth 6, with the pattern weights in file
+        minimax:100:e16     100 milliseconds per move, solved exactly from 16 empties (20)
+        minimax:b=file      one second per move, with the opening book in file
+        minimax:100:p       100 milliseconds per move, thinking on the opponent's time too
+        minimax:c=file:t2   one second per move, pruned with the probcut file, cutting at 2 sigmas (1.5)
+
+    Usage: tournament [options] <engine A> <engine B>
+        -g <games>    number of games, rounded up to an even number (100)
+        -t <threads>  threads playing games (hardware threads)
+        -s <size>     board size (8)
+        -r <plies>    random moves in every opening (8)
+        -b <file>     take the openings from a book file instead
+        -x <seed>     seed of the random openings (1)
+        -l <file>     write every game to a log file
+        -j <file>     write the search statistics of every minimax move as JSON lines
+        -a <file>     add every game to a game archive, see tools/records
+*/
+
+typedef std::function<std::unique_ptr<oth::Engine>()> EngineFactory;
+
+// Turns an engine name into a function that makes a new one.
+static EngineFactory makeFactory(const std::string& spec) {
+    std::vector<std::string> options;
+    std::istringstream parts(spec);
+    for (std::string part; std::getline(parts, part, ':');) options.push_back(part);
+
+    std::string name = options.empty() ? "" : options[0];
+
+    if (name == "random") {
+        if (options.size() > 1) throw std::invalid_argument("random takes no options");
+        return []() { return std::unique_ptr<oth::Engine>(new oth::RandomEngine()); };
+    }
+
+    if (name == "minimax") {
+        oth::SearchLimits limits;
+        limits.moveTime = 1000;
+        std::shared_ptr<const oth::PatternEvaluator> evaluator;
+        std::shared_ptr<const oth::OpeningBook> book;
+        std::shared_ptr<const oth::ProbCut> probCut;
+        // -1 keeps the default of the engine.
+        int endgameEmpties = -1;
+        double threshold = -1;
+        bool ponder = false;
+
+        for (size_t i = 1; i < options.size(); i++) {
+            const std::string& option = options[i];
+            if (option.compare(0, 2, "w=") == 0) {
+                // Loaded once, and shared by the engines of every thread.
+                evaluator.reset(new oth::PatternEvaluator(oth::PatternEvaluator::load(option.substr(2))));
+                continue;
+            }
+            if (option.compare(0, 2, "b=") == 0) {
+                // Mapped once, and shared by the engines of every thread.
+                book = oth::OpeningBook::open(option.substr(2));
+                continue;
+            }
+            if (option.compare(0, 2, "c=") == 0) {
+                probCut.reset(new oth::ProbCut(oth::ProbCut::load(option.substr(2))));
+                continue;
+            }
+            if (option[0] == 't') {
+                threshold = std::stod(option.substr(1));
+                continue;
+            }
+            if (option[0] == 'e') {
+                endgameEmpties = std::stoi(option.substr(1));
+                continue;
+            }
+            if (option == "p") {
+                ponder = true;
+                continue;
+            }
+
+            limits.moveTime = 0;
+            if (option[0] == 'd') limits.depth = std::stoi(option.substr(1));
+            else if (option[0] == 'n') limits.nodes = std::stoll(option.substr(1));
+            else limits.moveTime = std::stoi(option);
+        }
+
+        return [limits, evaluator, book, probCut, endgameEmpties, threshold, ponder]() {
+            oth::MinimaxEngine* engine = new oth::MinimaxEngine();
+            engine->verbose = false;
+            engine->setLimits(limits);
+            engine->setEvaluator(evaluator);
+            engine->setBook(book);
+            engine->setProbCut(probCut);
+            if (threshold >= 0) engine->setProbCutThreshold(threshold);
+            if (endgameEmpties >= 0) engine->setEndgameEmpties(endgameEmpties);
+            engine->ponder = ponder;
+            return std::unique_ptr<oth::Engine>(engine);
+        };
+    }
+
+    throw std::invalid_argument("Unknown engine: " + spec);
+}
+
+// Reads a book of opening lines in the usual notation, like "f5d6c3".
+static std::vector<std::vector<oth::Point>> readBook(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) throw std::invalid_argument("Can't open " + path);
+
+    std::vector<std::vector<oth::Point>> openings;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        std::vector<oth::Point> opening;
+        for (size_t i = 0; i < line.size() && !std::isspace(line[i]); i += 2) {
+            char column = std::tolower(line[i]);
+            if (column < 'a' || column > 'z' || i + 1 >= line.size() || !std::isdigit(line[i + 1])) {
+                throw std::invalid_argument("Bad opening in " + path + ": " + line);
+            }
+            opening.push_back(oth::Point(column - 'a', line[i + 1] - '1'));
+        }
+        openings.push_back(opening);
+    }
+
+    if (openings.empty()) throw std::invalid_argument(path + " has no openings");
+    return openings;
+}
+
+// Plays random moves from the start. Stops early if someone has to pass.
+static std::vector<oth::Point> randomOpening(int size, int plies, std::mt19937& rng) {
+    oth::RandomEngine engine;
+    oth::Othello board(size, engine, engine);
+    std::vector<oth::Point> opening;
+
+    for (int i = 0; i < plies; i++) {
+        const oth::MoveList& moves = board.getMoves(board.turn);
+        if (moves.empty()) break;
+
+        oth::Point move = moves[rng() % moves.size()];
+        opening.push_back(move);
+        board.playPiece(board.turn, move.x, move.y, false);
+        board.switchTurn();
+    }
+
+    return opening;
+}
+
+// What happened in one game, from engine A's side.
+struct GameResult {
+    // 1 for a win, 0.5 for a draw, 0 for a loss.
+    double score;
+    int moves[2];
+    double seconds[2];
+};
+
+// Times every move of the game, and passes the game on to a log.
+class TimingObserver : public oth::GameObserver {
+
+    GameResult& result;
+    oth::GameObserver& log;
+    bool aIsBlack;
+    std::chrono::steady_clock::time_point turnStart;
+
+public:
+
+    TimingObserver(GameResult& result, oth::GameObserver& log, bool aIsBlack) :
+        result(result), log(log), aIsBlack(aIsBlack) {}
+
+    void gameStarted(oth::Othello& board) { log.gameStarted(board); }
+    void passed(oth::Othello& board, oth::Color color) { log.passed(board, color); }
+    void gameOver(oth::Othello& board) { log.gameOver(board); }
+    void message(const std::string& text) { log.message(text); }
+
+    void turnStarted(oth::Othello& board) {
+        log.turnStarted(board);
+        turnStart = std::chrono::steady_clock::now();
+    }
+
+    void movePlayed(oth::Othello& board, oth::Color color, oth::Point move) {
+        int side = (color == oth::black) == aIsBlack ? 0 : 1;
+        result.seconds[side] += std::chrono::duration<double>(std::chrono::steady_clock::now() - turnStart).count();
+        result.moves[side]++;
+        log.movePlayed(board, color, move);
+    }
+};
+
+// Plays one game to the end. Index 0 of the engines is A, and aIsBlack tells its color.
+// Throws if an opening or an engine plays an illegal move.
+static GameResult playGame(int size, const std::vector<oth::Point>& opening, oth::Engine* engines[2], bool aIsBlack, oth::GameObserver& log) {
+    oth::Engine& black = *engines[aIsBlack ? 0 : 1];
+    oth::Engine& white = *engines[aIsBlack ? 1 : 0];
+
+    oth::Othello board(size, white, black);
+
+    GameResult result = {};
+    TimingObserver timing(result, log, aIsBlack);
+    board.setObserver(timing);
+
+    // The opening goes to the undo stack, so a game record starts with it.
+    for (size_t i = 0; i < opening.size(); i++) {
+        if (!board.getMoves(board.turn).contains(opening[i])) throw std::runtime_error("Illegal move in an opening");
+        board.playPiece(board.turn, opening[i].x, opening[i].y, true);
+        board.switchTurn();
+    }
+
+    board.startGame(board.turn);
+
+    int diff = board.getScore(oth::black) - board.getScore(oth::white);
+    if (!aIsBlack) diff = -diff;
+    result.score = diff > 0 ? 1 : diff < 0 ? 0 : 0.5;
+
+    return result;
+}
+
+// Elo difference that gives the expected score, with its sign. A score of 0 or 1,
+// or a bound past them, has no finite Elo, so it is shown as -inf or +inf.
+static std::string elo(double score) {
+    if (score <= 0) return "-inf";
+    if (score >= 1) return "+inf";
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(1) << std::showpos << -400 * std::log10(1 / score - 1);
+    return text.str();
+}
+
+static void usage() {
+    std::cerr << "Usage: tournament [-g games] [-t threads] [-s size] [-r plies] [-b book] [-x seed] [-l log] [-j stats] [-a archive] <engine A> <engine B>" << std::endl;
+    std::cerr << "Engines: random, minimax, with options minimax:<ms>, minimax:d<depth>, minimax:n<nodes>, minimax:w=<weights>, minimax:e<empties>, minimax:b=<book>, minimax:p, minimax:c=<probcut>, minimax:t<sigmas>" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int games = 100;
+    int threads = std::thread::hardware_concurrency();
+    int size = 8;
+    int plies = 8;
+    unsigned seed = 1;
+    std::string bookPath;
+    std::string logPath;
+    std::string statsPath;
+    std::string archivePath;
+    std::vector<std::string> names;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc) {
+            std::string value = argv[++i];
+            switch (arg[1]) {
+                case 'g': games = std::stoi(value); break;
+                case 't': threads = std::stoi(value); break;
+                case 's': size = std::stoi(value); break;
+                case 'r': plies = std::stoi(value); break;
+                case 'b': bookPath = value; break;
+                case 'x': seed = std::stoul(value); break;
+                case 'l': logPath = value; break;
+                case 'j': statsPath = value; break;
+                case 'a': archivePath = value; break;
+                default: usage(); return 2;
+            }
+        } else {
+            names.push_back(arg);
+        }
+    }
+
+    if (names.size() != 2) {
+        usage();
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+    if (games < 2) games = 2;
+    int pairs = (games + 1) / 2;
+
+    EngineFactory factories[2];
+    std::vector<std::vector<oth::Point>> openings;
+    try {
+        factories[0] = makeFactory(names[0]);
+        factories[1] = makeFactory(names[1]);
+
+        if (!bookPath.empty()) {
+            std::vector<std::vector<oth::Point>> book = readBook(bookPath);
+            for (int i = 0; i < pairs; i++) openings.push_back(book[i % book.size()]);
+        } else {
+            std::mt19937 rng(seed);
+            for (int i = 0; i < pairs; i++) openings.push_back(randomOpening(size, plies, rng));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    std::cout << names[0] << " vs " << names[1] << ", " << pairs * 2 << " games on " << size << "x" << size << ", "
+        << (bookPath.empty() ? std::to_string(plies) + " random plies" : "openings from " + bookPath) << ", "
+        << threads << " threads" << std::endl;
+
+    // Game 2i and 2i+1 play opening i, with A as black first.
+    std::vector<GameResult> results(pairs * 2);
+    std::atomic<int> nextGame(0);
+    std::mutex errorLock;
+    std::string error;
+
+    // Games are logged on their own, and written whole when they end.
+    std::ofstream logFile;
+    std::mutex logLock;
+    if (!logPath.empty()) {
+        logFile.open(logPath);
+        if (!logFile) {
+            std::cerr << "Can't open " << logPath << std::endl;
+            return 2;
+        }
+    }
+
+    // Same for the statistics.
+    std::ofstream statsFile;
+    std::mutex statsLock;
+    if (!statsPath.empty()) {
+        statsFile.open(statsPath);
+        if (!statsFile) {
+            std::cerr << "Can't open " << statsPath << std::endl;
+            return 2;
+        }
+    }
+
+    // Games are added to the archive as they end, from every thread.
+    std::unique_ptr<oth::GameWriter> archive;
+    if (!archivePath.empty()) {
+        try {
+            archive.reset(new oth::GameWriter(archivePath));
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 2;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([&]() {
+            std::unique_ptr<oth::Engine> a = factories[0]();
+            std::unique_ptr<oth::Engine> b = factories[1]();
+            oth::Engine* engines[2] = { a.get(), b.get() };
+
+            std::ostringstream stats;
+            if (!statsPath.empty()) {
+                for (int side = 0; side < 2; side++) {
+                    oth::MinimaxEngine* minimax = dynamic_cast<oth::MinimaxEngine*>(engines[side]);
+                    if (minimax) minimax->statsOutput = &stats;
+                }
+            }
+
+            for (int game = nextGame++; game < pairs * 2; game = nextGame++) {
+                try {
+                    bool aIsBlack = game % 2 == 0;
+                    oth::NullObserver none;
+                    std::ostringstream text;
+                    oth::LogObserver log(text);
+                    if (!logPath.empty()) text << "game " << game + 1 << ", A is " << (aIsBlack ? "black" : "white") << "\n";
+                    oth::GameObserver& shown = logPath.empty() ? (oth::GameObserver&)none : log;
+
+                    if (archive) {
+                        oth::GameRecorder recorder(*archive);
+                        recorder.blackName = names[aIsBlack ? 0 : 1];
+                        recorder.whiteName = names[aIsBlack ? 1 : 0];
+                        oth::SplitObserver both(shown, recorder);
+                        results[game] = playGame(size, openings[game / 2], engines, aIsBlack, both);
+                    } else {
+                        results[game] = playGame(size, openings[game / 2], engines, aIsBlack, shown);
+                    }
+
+                    if (!logPath.empty()) {
+                        std::lock_guard<std::mutex> lock(logLock);
+                        logFile << text.str();
+                    }
+
+                    if (!statsPath.empty()) {
+                        std::lock_guard<std::mutex> lock(statsLock);
+                        statsFile << stats.str();
+                        stats.str("");
+                    }
+                } catch (const std::exception& e) {
+                    std::lock_guard<std::mutex> lock(errorLock);
+                    error = e.what();
+                    nextGame = pairs * 2;
+                }
+            }
+        });
+    }
+    for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+    if (archive) archive->flush();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!error.empty()) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    int wins = 0, draws = 0, losses = 0;
+    long long moves[2] = { 0, 0 };
+    double moveSeconds[2] = { 0, 0 };
+    double total = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        if (results[i].score == 1) wins++;
+        else if (results[i].score == 0) losses++;
+        else draws++;
+
+        total += results[i].score;
+        for (int side = 0; side < 2; side++) {
+            moves[side] += results[i].moves[side];
+            moveSeconds[side] += results[i].seconds[side];
+        }
+    }
+
+    // 95% interval of the mean score, from the spread of the game scores.
+    int n = results.size();
+    double mean = total / n;
+    double variance = 0;
+    for (size_t i = 0; i < results.size(); i++) variance += (results[i].score - mean) * (results[i].score - mean);
+    double margin = 1.96 * std::sqrt(variance / n / n);
+
+    std::cout << "Wins " << wins << ", draws " << draws << ", losses " << losses
+        << " (score " << std::fixed << std::setprecision(1) << mean * 100 << "%)" << std::endl;
+    std::cout << "Elo " << elo(mean) << " (95%: " << elo(mean - margin) << " to " << elo(mean + margin) << ")" << std::endl;
+    for (int side = 0; side < 2; side++) {
+        std::cout << "Time per move, " << names[side] << ": " << std::setprecision(2)
+            << (moves[side] ? moveSeconds[side] * 1000 / moves[side] : 0) << "ms" << std::endl;
+    }
+    std::cout << n << " games in " << std::setprecision(1) << seconds << "s, "
+        << std::setprecision(2) << n / seconds << " games/s" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,233 @@
+#include "othello.h"
+#include "randomengine.cpp"
+#include "minimaxengine.cpp"
+#include "evaluator.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+/*
+    Fits the weights of PatternEvaluator, and writes them to a weight file.
+
+    Games are played by a shallow search with some random moves, so many
+    different positions are seen. Every position of a game is labeled with the
+    final disc difference, and the weights are fitted to it by stochastic
+    gradient descent, one set for every phase. The last tenth of the games is
+    kept apart to measure the error.
+
+    Weights can be fitted again from games played with earlier weights (-w),
+    which gives better games, and so better labels.
+
+    Usage: trainpatterns [options] <output file>
+        -g <games>    games to play (10000)
+        -t <threads>  threads playing games (hardware threads)
+        -s <size>     board size (8)
+        -d <depth>    search depth of the moves (2)
+        -e <epochs>   passes over the positions (20)
+        -w <file>     play the games with these weights
+        -x <seed>     seed of the random moves (1)
+*/
+
+// One position, seen from black.
+struct Sample {
+    unsigned short patterns[oth::patterns::INSTANCES];
+    short mobility;
+    unsigned char phase;
+    // Final disc difference of the game.
+    short target;
+};
+
+// Plays one game, and returns its positions with their labels.
+// phases only tells the phase of the positions.
+static std::vector<Sample> playGame(oth::MinimaxEngine& engine, const oth::PatternEvaluator& phases, int size, unsigned seed) {
+    std::mt19937 rng(seed);
+    oth::RandomEngine random;
+    oth::Othello board(size, random, random);
+
+    // Random openings, so games don't repeat.
+    int randomPlies = rng() % 12;
+
+    std::vector<Sample> samples;
+    bool passed = false;
+    for (int ply = 0;; ply++) {
+        const oth::MoveList& moves = board.getMoves(board.turn);
+        if (moves.empty()) {
+            if (passed) break;
+            passed = true;
+            board.switchTurn();
+            continue;
+        }
+        passed = false;
+
+        oth::Point move;
+        if (ply < randomPlies || rng() % 10 == 0) move = moves[rng() % moves.size()];
+        else move = engine.nextMove(board);
+
+        board.playPiece(board.turn, move.x, move.y, false);
+        board.switchTurn();
+
+        Sample sample;
+        for (int i = 0; i < oth::patterns::INSTANCES; i++) sample.patterns[i] = board.getPattern(i);
+        sample.mobility = board.getMoves(oth::black).size() - board.getMoves(oth::white).size();
+        sample.phase = phases.phase(board.getScore(oth::black) + board.getScore(oth::white));
+        samples.push_back(sample);
+    }
+
+    short diff = board.getScore(oth::black) - board.getScore(oth::white);
+    for (size_t i = 0; i < samples.size(); i++) samples[i].target = diff;
+
+    return samples;
+}
+
+// Weights while fitting, in discs.
+struct Model {
+    std::vector<float> tables[oth::PatternEvaluator::PHASES][oth::patterns::SHAPES];
+    float mobility[oth::PatternEvaluator::PHASES];
+
+    Model(int size) {
+        for (int p = 0; p < oth::PatternEvaluator::PHASES; p++) {
+            for (int shape = 0; shape < oth::patterns::SHAPES; shape++) tables[p][shape].assign(oth::patterns::values(shape, size), 0);
+            mobility[p] = 0;
+        }
+    }
+
+    float predict(const Sample& s) const {
+        float score = mobility[s.phase] * s.mobility;
+        for (int i = 0; i < oth::patterns::INSTANCES; i++) score += tables[s.phase][oth::patterns::shapeOf[i]][s.patterns[i]];
+        return score;
+    }
+
+    void learn(const Sample& s, float rate) {
+        float error = (s.target - predict(s)) * rate;
+        // Mobility is seen in every position, so it moves slower than the tables.
+        mobility[s.phase] += error * s.mobility * 0.01f;
+        for (int i = 0; i < oth::patterns::INSTANCES; i++) tables[s.phase][oth::patterns::shapeOf[i]][s.patterns[i]] += error;
+    }
+};
+
+// Mean absolute error in discs.
+static double meanError(const Model& model, const std::vector<Sample>& samples) {
+    double total = 0;
+    for (size_t i = 0; i < samples.size(); i++) total += std::fabs(samples[i].target - model.predict(samples[i]));
+    return samples.empty() ? 0 : total / samples.size();
+}
+
+static void usage() {
+    std::cerr << "Usage: trainpatterns [-g games] [-t threads] [-s size] [-d depth] [-e epochs] [-w weights] [-x seed] <output file>" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int games = 10000;
+    int threads = std::thread::hardware_concurrency();
+    int size = 8;
+    int depth = 2;
+    int epochs = 20;
+    unsigned seed = 1;
+    std::string startPath;
+    std::string outPath;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc) {
+            std::string value = argv[++i];
+            switch (arg[1]) {
+                case 'g': games = std::stoi(value); break;
+                case 't': threads = std::stoi(value); break;
+                case 's': size = std::stoi(value); break;
+                case 'd': depth = std::stoi(value); break;
+                case 'e': epochs = std::stoi(value); break;
+                case 'w': startPath = value; break;
+                case 'x': seed = std::stoul(value); break;
+                default: usage(); return 2;
+            }
+        } else {
+            outPath = arg;
+        }
+    }
+
+    if (outPath.empty()) {
+        usage();
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+
+    std::shared_ptr<const oth::PatternEvaluator> start;
+    try {
+        if (!startPath.empty()) start.reset(new oth::PatternEvaluator(oth::PatternEvaluator::load(startPath)));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    oth::PatternEvaluator evaluator(size);
+
+    // Play the games. Every game has its own seed, so the thread count doesn't change them.
+    std::vector<std::vector<Sample>> played(games);
+    std::atomic<int> nextGame(0);
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([&]() {
+            oth::MinimaxEngine engine(4);
+            engine.verbose = false;
+            oth::SearchLimits limits;
+            limits.depth = depth;
+            engine.setLimits(limits);
+            engine.setEvaluator(start);
+
+            for (int game = nextGame++; game < games; game = nextGame++) {
+                played[game] = playGame(engine, evaluator, size, seed * 1000003u + game);
+            }
+        });
+    }
+    for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+
+    std::vector<Sample> training, testing;
+    for (int game = 0; game < games; game++) {
+        std::vector<Sample>& to = game < games - games / 10 ? training : testing;
+        to.insert(to.end(), played[game].begin(), played[game].end());
+    }
+
+    std::cout << training.size() << " positions to fit, " << testing.size() << " to test" << std::endl;
+
+    Model model(size);
+    std::mt19937 rng(seed);
+    for (int epoch = 1; epoch <= epochs; epoch++) {
+        std::shuffle(training.begin(), training.end(), rng);
+
+        // Slow down towards the end.
+        float rate = 0.004f / (1 + epoch * 0.2f);
+        for (size_t i = 0; i < training.size(); i++) model.learn(training[i], rate);
+
+        std::cout << "epoch " << std::setw(3) << epoch << std::fixed << std::setprecision(2)
+            << "  error " << meanError(model, training) << " / " << meanError(model, testing) << " discs" << std::endl;
+    }
+
+    // Round to the units of the evaluator.
+    for (int p = 0; p < oth::PatternEvaluator::PHASES; p++) {
+        evaluator.mobility(p) = std::lround(model.mobility[p] * oth::PatternEvaluator::SCALE);
+        for (int shape = 0; shape < oth::patterns::SHAPES; shape++) {
+            for (size_t v = 0; v < model.tables[p][shape].size(); v++) {
+                float w = model.tables[p][shape][v] * oth::PatternEvaluator::SCALE;
+                evaluator.weight(p, shape, v) = std::lround(std::max(-32000.0f, std::min(32000.0f, w)));
+            }
+        }
+    }
+
+    try {
+        evaluator.save(outPath);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << outPath << std::endl;
+    return 0;
+}